@@ -0,0 +1,32 @@
+// Generated by tools/metatiles.py from tileMap in src/main.cpp, do not edit
+// 29 rows x 18 columns: 522 bytes raw, 135 bytes of metatile map + 6 metatiles (24 bytes)
+#define MAP_META_HEIGHT 29
+#define MAP_META_WIDTH 18
+
+// 2x2 tiles: top left, top right, bottom left, bottom right
+const byte ucMetatiles[][4] PROGMEM = {
+  {0, 1, 0, 1}, // 0
+  {0, 0, 1, 0}, // 1
+  {0, 0, 0, 0}, // 2
+  {1, 0, 1, 0}, // 3
+  {1, 1, 1, 1}, // 4
+  {1, 1, 1, 0}, // 5
+};
+
+const byte ucMetaMap[15][9] PROGMEM = {
+  /* 00 */ { 0,  1,  2,  2,  2,  2,  2,  2,  3},
+  /* 02 */ { 0,  4,  1,  2,  2,  2,  2,  2,  3},
+  /* 04 */ { 0,  4,  4,  1,  2,  2,  2,  2,  3},
+  /* 06 */ { 0,  4,  4,  4,  1,  2,  2,  2,  3},
+  /* 08 */ { 0,  4,  4,  4,  4,  1,  2,  2,  3},
+  /* 10 */ { 0,  4,  4,  4,  4,  4,  1,  2,  3},
+  /* 12 */ { 0,  4,  4,  4,  4,  4,  4,  1,  3},
+  /* 14 */ { 0,  4,  4,  4,  4,  4,  4,  5,  3},
+  /* 16 */ { 0,  4,  4,  4,  4,  4,  5,  2,  3},
+  /* 18 */ { 0,  4,  4,  4,  4,  5,  2,  2,  3},
+  /* 20 */ { 0,  4,  4,  4,  5,  2,  2,  2,  3},
+  /* 22 */ { 0,  4,  4,  5,  2,  2,  2,  2,  3},
+  /* 24 */ { 0,  4,  5,  2,  2,  2,  2,  2,  3},
+  /* 26 */ { 0,  5,  2,  2,  2,  2,  2,  2,  3},
+  /* 28 */ { 0,  2,  2,  2,  2,  2,  2,  0,  3},
+};
@@ -0,0 +1,43 @@
+// Generated by tools/maprle.py from tileMap in src/main.cpp, do not edit
+// 29 rows x 18 columns: 522 bytes raw, 286 bytes RLE + 58 bytes row index
+#define MAP_RLE_HEIGHT 29
+#define MAP_RLE_WIDTH 18
+
+const byte ucMapRLE[] PROGMEM = {
+  /* 00 */ 1, 0, 1, 1, 14, 0, 1, 1, 1, 0,
+  /* 01 */ 1, 0, 2, 1, 13, 0, 1, 1, 1, 0,
+  /* 02 */ 1, 0, 3, 1, 12, 0, 1, 1, 1, 0,
+  /* 03 */ 1, 0, 4, 1, 11, 0, 1, 1, 1, 0,
+  /* 04 */ 1, 0, 5, 1, 10, 0, 1, 1, 1, 0,
+  /* 05 */ 1, 0, 6, 1, 9, 0, 1, 1, 1, 0,
+  /* 06 */ 1, 0, 7, 1, 8, 0, 1, 1, 1, 0,
+  /* 07 */ 1, 0, 8, 1, 7, 0, 1, 1, 1, 0,
+  /* 08 */ 1, 0, 9, 1, 6, 0, 1, 1, 1, 0,
+  /* 09 */ 1, 0, 10, 1, 5, 0, 1, 1, 1, 0,
+  /* 10 */ 1, 0, 11, 1, 4, 0, 1, 1, 1, 0,
+  /* 11 */ 1, 0, 12, 1, 3, 0, 1, 1, 1, 0,
+  /* 12 */ 1, 0, 13, 1, 2, 0, 1, 1, 1, 0,
+  /* 13 */ 1, 0, 14, 1, 1, 0, 1, 1, 1, 0,
+  /* 14 */ 1, 0, 16, 1, 1, 0,
+  /* 15 */ 1, 0, 14, 1, 1, 0, 1, 1, 1, 0,
+  /* 16 */ 1, 0, 13, 1, 2, 0, 1, 1, 1, 0,
+  /* 17 */ 1, 0, 12, 1, 3, 0, 1, 1, 1, 0,
+  /* 18 */ 1, 0, 11, 1, 4, 0, 1, 1, 1, 0,
+  /* 19 */ 1, 0, 10, 1, 5, 0, 1, 1, 1, 0,
+  /* 20 */ 1, 0, 9, 1, 6, 0, 1, 1, 1, 0,
+  /* 21 */ 1, 0, 8, 1, 7, 0, 1, 1, 1, 0,
+  /* 22 */ 1, 0, 7, 1, 8, 0, 1, 1, 1, 0,
+  /* 23 */ 1, 0, 6, 1, 9, 0, 1, 1, 1, 0,
+  /* 24 */ 1, 0, 5, 1, 10, 0, 1, 1, 1, 0,
+  /* 25 */ 1, 0, 4, 1, 11, 0, 1, 1, 1, 0,
+  /* 26 */ 1, 0, 3, 1, 12, 0, 1, 1, 1, 0,
+  /* 27 */ 1, 0, 2, 1, 13, 0, 1, 1, 1, 0,
+  /* 28 */ 1, 0, 1, 1, 13, 0, 2, 1, 1, 0,
+};
+
+const unsigned int uiMapRLERows[MAP_RLE_HEIGHT] PROGMEM = {
+  0, 10, 20, 30, 40, 50, 60, 70,
+  80, 90, 100, 110, 120, 130, 140, 146,
+  156, 166, 176, 186, 196, 206, 216, 226,
+  236, 246, 256, 266, 276,
+};
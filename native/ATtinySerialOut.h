@@ -0,0 +1,30 @@
+// Host stand-in for lib/ATtinySerialOut: Serial prints to stdout
+#ifndef NATIVE_ATTINY_SERIAL_OUT_H
+#define NATIVE_ATTINY_SERIAL_OUT_H
+
+#include <stdio.h>
+
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+
+class TinySerialOut {
+public:
+  void print(const __FlashStringHelper *aStringPtr) { fputs((const char *)aStringPtr, stdout); }
+  void print(const char *aStringPtr) { fputs(aStringPtr, stdout); }
+  void print(char aChar) { putchar(aChar); }
+  void print(int aInteger) { printf("%d", aInteger); }
+  void print(unsigned int aInteger) { printf("%u", aInteger); }
+  void print(long aLong) { printf("%ld", aLong); }
+  void print(unsigned long aLong) { printf("%lu", aLong); }
+  template <typename T> void println(T aValue) {
+    print(aValue);
+    println();
+  }
+  void println() { putchar('\n'); }
+};
+
+extern TinySerialOut Serial;
+
+inline void initTXPin() {}
+
+#endif
@@ -0,0 +1,75 @@
+// Host stand-in for the Arduino core on the ATtiny85, just what src/main.cpp
+// uses. The I/O registers are plain bytes, except that writes to PORTB and
+// DDRB drive the SSD1306 model and enabling a Timer1 interrupt runs it.
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+#define F_CPU 8000000L
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PORTB0 0
+#define PORTB1 1
+#define PORTB2 2
+#define PORTB3 3
+#define PORTB4 4
+#define PORTB5 5
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define A0 0
+#define CHANGE 1
+
+// Timer1 and pin change interrupt bits
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define CS13 3
+#define CTC1 7
+#define OCIE1A 6
+#define OCF1A 6
+#define PCIE 5
+
+// An I/O register, pfnWrite (if any) runs after every write
+struct NativeReg {
+  uint8_t v;
+  void (*pfnWrite)();
+
+  operator uint8_t() const { return v; }
+  NativeReg &operator=(uint8_t n) {
+    v = n;
+    if (pfnWrite)
+      pfnWrite();
+    return *this;
+  }
+  NativeReg &operator|=(uint8_t n) { return *this = v | n; }
+  NativeReg &operator&=(uint8_t n) { return *this = v & n; }
+};
+
+extern NativeReg PORTB, DDRB, GIMSK, PCMSK;
+extern NativeReg TCCR1, TCNT1, OCR1A, OCR1C, TIFR, TIMSK;
+extern volatile uint8_t PINB;
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t irq, void (*fn)(), int mode);
+
+// Which PORTB bits carry the I2C bus (the engine's SSD1306_SCL/SSD1306_SDA)
+void nativeBusPins(byte bScl, byte bSda);
+// If set, every change of the bus levels is written here as "<scl> <sda>"
+extern FILE *pBusTrace;
+
+#endif
@@ -0,0 +1,13 @@
+// Host stand-in for avr/interrupt.h: an ISR is a plain function, called by
+// the fake registers when it would fire
+#ifndef NATIVE_INTERRUPT_H
+#define NATIVE_INTERRUPT_H
+
+#define ISR(vector) void vector()
+#define cli()
+#define sei()
+
+void TIMER1_COMPA_vect();
+void PCINT0_vect();
+
+#endif
@@ -0,0 +1,31 @@
+// Host stand-in for avr/pgmspace.h: flash is ordinary memory
+#ifndef NATIVE_PGMSPACE_H
+#define NATIVE_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) nativeReadWord(p)
+#define pgm_read_ptr(p) nativeReadPtr(p)
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+
+// Through memcpy: the tables read this way are declared with other types
+static inline uint16_t nativeReadWord(const void *p) {
+  uint16_t w;
+
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+static inline void *nativeReadPtr(const void *p) {
+  void *v;
+
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+#endif
@@ -0,0 +1,217 @@
+// Native build: the engine in src/main.cpp runs on the host against the fake
+// I/O in this directory, its I2C output drives the SSD1306 model. The engine
+// is compiled into this file so the driver can reach its state.
+//
+// usage: program [-n frames] [-b] [-o prefix] [-png] [-i trace] [-verify]
+//   -n frames  frames to run, the encoder moves one step before each but the
+//              first (default 1)
+//   -b         turn the encoder the other way
+//   -o prefix  save every frame as <prefix>0000.pbm, <prefix>0001.pbm, ...
+//   -png       save PNG instead of PBM
+//   -i trace   write the SCL/SDA levels to trace, with a "# frame N" line
+//              before each frame (decode it with tools/i2ctrace.py)
+//   -verify    instead of running frames, draw the playfield at every scroll
+//              position of the map period, then game frames with Mario from
+//              negative and out of period positions, and compare what the
+//              display shows with a reference render, exit status 1 on any
+//              difference
+// Prints one CSV line per frame: the scroll position it was drawn at and the
+// bus traffic it took.
+#define MAP_KEEP_TILEMAP // the reference reads the plain map in every build
+#include "../src/main.cpp"
+#include "ssd1306.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef I2C_USI
+#error "the native build models the bit-banged bus only"
+#endif
+
+static const char szUsage[] = "usage: %s [-n frames] [-b] [-o prefix] [-png] [-i trace] [-verify]\n";
+
+static int FloorMod(int v, int n) {
+  v %= n;
+  return (v < 0) ? v + n : v;
+}
+
+// The screen at a scroll position of the wrapped world, every pixel looked
+// up in the plain tileMap on its own: no ring buffer, no map decoding, no
+// shifting of whole bytes
+static void ReferenceFrame(int iScrollX, int iScrollY, uint8_t out[8][128]) {
+  unsigned int wx, wy;
+  byte bTile;
+  int r, x;
+
+  iScrollX = FloorMod(iScrollX, TILEMAP_WIDTH * MODULE);
+  iScrollY = FloorMod(iScrollY, TILEMAP_HEIGHT * MODULE);
+  memset(out, 0, 8 * 128);
+  for (r = 0; r < SCREEN_HEIGHT; r++) {
+    wy = iScrollY + (EDGES / 2) * MODULE + r;
+    for (x = 0; x < SCREEN_WIDTH; x++) {
+      wx = iScrollX + (EDGES / 2) * MODULE + x;
+      bTile = pgm_read_byte(&tileMap[(wy >> 3) % TILEMAP_HEIGHT][(wx >> 3) % TILEMAP_WIDTH]);
+      if (pgm_read_byte(&ucTiles[bTile * MODULE + (wx & 7)]) & (1 << (wy & 7)))
+        out[r >> 3][x] |= 1 << (r & 7);
+    }
+  }
+}
+
+// A sprite at screen position sx, sy blended in pixel by pixel
+static void ReferenceSprite(uint8_t out[8][128], byte bType, byte bFlags, int sx, int sy) {
+  SPRITE_DESC desc;
+  int u, v, su, sv, x, y;
+  byte bMask, bPattern, bPixel;
+
+  memcpy_P(&desc, &spriteTable[bType], sizeof(desc));
+  for (v = 0; v < desc.bPages * MODULE; v++) {
+    for (u = 0; u < desc.bWidth; u++) {
+      x = sx + u;
+      y = sy + v;
+      if (x < 0 || x >= SCREEN_WIDTH || y < 0 || y >= SCREEN_HEIGHT)
+        continue;
+      su = (bFlags & SPRITE_FLIP_H) ? desc.bWidth - 1 - u : u;
+      sv = (bFlags & SPRITE_FLIP_V) ? desc.bPages * MODULE - 1 - v : v;
+      bMask = (pgm_read_byte(&ucSprites[desc.uiMask + (sv >> 3) * desc.bWidth + su]) >> (sv & 7)) & 1;
+      bPattern = (pgm_read_byte(&ucSprites[desc.uiPattern + (sv >> 3) * desc.bWidth + su]) >> (sv & 7)) & 1;
+      bPixel = (out[y >> 3][x] >> (y & 7)) & 1;
+      if (bFlags & SPRITE_XOR)
+        bPixel ^= bPattern;
+      else if (bFlags & SPRITE_OPAQUE)
+        bPixel = bPattern;
+      else
+        bPixel = (bPixel & bMask) | bPattern;
+      out[y >> 3][x] = (out[y >> 3][x] & ~(1 << (y & 7))) | (bPixel << (y & 7));
+    }
+  }
+}
+
+static long lVerifyFrames, lVerifyBad;
+
+// Compare the display with the reference, x and y as given to the frame
+static void VerifyFrame(int x, int y, bool bMario) {
+  uint8_t screen[8][128], gold[8][128];
+
+  ssd1306Screen(screen);
+  ReferenceFrame(x, y, gold);
+#ifdef OLED_HW_SCROLL
+  bMario = 0; // OLED_HW_SCROLL has no sprites, see its option comment
+#endif
+  if (bMario)
+    ReferenceSprite(gold, SPRITE_MARIO, 0, 14, 40); // where gameLoop() pins him
+  lVerifyFrames++;
+  if (memcmp(screen, gold, sizeof(screen)) && lVerifyBad++ < 10)
+    printf("mismatch at scroll %d,%d%s\n", x, y, bMario ? " (game)" : "");
+}
+
+// First DrawPlayfield at every (iScrollX, iScrollY) of the map period,
+// without sprites. The rows go back and forth so every step is 1px and the
+// ring buffer streams as it does in the game. Then whole game frames with
+// Mario from scroll positions outside the period, as the encoder leaves
+// them: 1px walks across the map edges in both directions and jumps to
+// negative and out of period positions. Returns the frames that differ.
+static long Verify() {
+  int x, y, i, iStep = 1, n, iDir;
+
+  for (i = 0; i < bObjects; i++)
+    object_list[i].x = -1000; // off screen at any scroll position
+  iScrollX = iScrollY = 0;
+  for (y = 0; y < TILEMAP_HEIGHT * MODULE; y++) {
+    for (i = 0; i < TILEMAP_WIDTH * MODULE; i++) {
+      x = (iStep > 0) ? i : TILEMAP_WIDTH * MODULE - 1 - i;
+      iScrollX = x;
+      iScrollY = y;
+      DrawPlayfield(iScrollX, iScrollY);
+      VerifyFrame(x, y, 0);
+    }
+    iStep = -iStep;
+  }
+
+  for (iDir = 0; iDir < 2; iDir++) {
+    backgroundDirection = iDir;
+    iScrollX = iScrollY = 0;
+    for (n = 0; n < 3 * TILEMAP_HEIGHT * MODULE; n++) {
+      moveBackgroundTo(n >= TILEMAP_HEIGHT * MODULE); // back past 0, then forward past the period
+      x = iScrollX;
+      y = iScrollY;
+      gameLoop();
+      VerifyFrame(x, y, 1);
+    }
+  }
+  backgroundDirection = 0;
+  for (y = 1 - TILEMAP_HEIGHT * MODULE; y < 2 * TILEMAP_HEIGHT * MODULE; y += 13) {
+    for (x = 1 - TILEMAP_WIDTH * MODULE; x < 2 * TILEMAP_WIDTH * MODULE; x += 11) {
+      iScrollX = x;
+      iScrollY = y;
+      gameLoop();
+      VerifyFrame(x, y, 1);
+    }
+  }
+  printf("verify: %ld frames, %ld mismatches\n", lVerifyFrames, lVerifyBad);
+  return lVerifyBad;
+}
+
+int main(int argc, char **argv) {
+  long lFrames = 1, f;
+  bool bBack = 0, bPng = 0, bVerify = 0;
+  const char *szPrefix = NULL;
+  char szName[256];
+  SSD1306_STATS last;
+  int i, x, y;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      lFrames = atol(argv[++i]);
+    } else if (!strcmp(argv[i], "-b")) {
+      bBack = 1;
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      szPrefix = argv[++i];
+    } else if (!strcmp(argv[i], "-png")) {
+      bPng = 1;
+    } else if (!strcmp(argv[i], "-verify")) {
+      bVerify = 1;
+    } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+      if (!(pBusTrace = fopen(argv[++i], "w"))) {
+        perror(argv[i]);
+        return 1;
+      }
+    } else {
+      fprintf(stderr, szUsage, argv[0]);
+      return 2;
+    }
+  }
+
+  nativeBusPins(SSD1306_SCL, SSD1306_SDA);
+  ssd1306Reset();
+  if (pBusTrace)
+    fprintf(pBusTrace, "# setup\n");
+  setup(); // BENCHMARK builds print their results here
+  if (bVerify)
+    return Verify() ? 1 : 0;
+
+  printf("frame,scroll_x,scroll_y,transactions,cmd_bytes,data_bytes,scl_clocks\n");
+  for (f = 0; f < lFrames; f++) {
+    if (f)
+      moveBackgroundTo(!bBack);
+    last = ssd1306Stats;
+    if (pBusTrace)
+      fprintf(pBusTrace, "# frame %ld\n", f);
+    gameLoop();
+    x = iScrollX; // as drawn: gameLoop() wraps it first
+    y = iScrollY;
+    printf("%ld,%d,%d,%lu,%lu,%lu,%lu\n", f, x, y,
+           ssd1306Stats.ulTransactions - last.ulTransactions,
+           ssd1306Stats.ulCmdBytes - last.ulCmdBytes,
+           ssd1306Stats.ulDataBytes - last.ulDataBytes,
+           ssd1306Stats.ulSclClocks - last.ulSclClocks);
+    if (szPrefix) {
+      snprintf(szName, sizeof(szName), "%s%04ld.%s", szPrefix, f, bPng ? "png" : "pbm");
+      if (!(bPng ? ssd1306WritePNG(szName) : ssd1306WritePBM(szName))) {
+        perror(szName);
+        return 1;
+      }
+    }
+  }
+  if (pBusTrace)
+    fclose(pBusTrace);
+  return 0;
+}
@@ -0,0 +1,71 @@
+// Fake ATtiny85 I/O for the native build: registers, time and interrupts
+#include "Arduino.h"
+#include "ATtinySerialOut.h"
+#include "ssd1306.h"
+#include <chrono>
+#include <stdio.h>
+
+static byte bSclBit = PORTB4, bSdaBit = PORTB3; // the bit-banged defaults
+FILE *pBusTrace;
+
+// Open drain bus: a line is high unless its pin is an output driving low
+static void BusWrite() {
+  static bool bLastScl = 1, bLastSda = 1;
+  bool bScl = !(DDRB.v & (1 << bSclBit)) || (PORTB.v & (1 << bSclBit));
+  bool bSda = !(DDRB.v & (1 << bSdaBit)) || (PORTB.v & (1 << bSdaBit));
+
+  if (pBusTrace && (bScl != bLastScl || bSda != bLastSda))
+    fprintf(pBusTrace, "%d %d\n", bScl, bSda);
+  bLastScl = bScl;
+  bLastSda = bSda;
+  ssd1306Bus(bScl, bSda);
+}
+
+// The compare interrupt fires as soon as it is enabled, and keeps firing
+// until the handler disables it: an OLED_ASYNC page goes out in one go
+static void TimerWrite() {
+  static bool bInIsr;
+
+  if (bInIsr)
+    return;
+  bInIsr = 1;
+  while (TIMSK.v & (1 << OCIE1A))
+    TIMER1_COMPA_vect();
+  bInIsr = 0;
+}
+
+NativeReg PORTB = {0, BusWrite}, DDRB = {0, BusWrite}, GIMSK, PCMSK;
+NativeReg TCCR1, TCNT1, OCR1A, OCR1C, TIFR, TIMSK = {0, TimerWrite};
+volatile uint8_t PINB;
+TinySerialOut Serial;
+
+// Handlers the engine doesn't define
+__attribute__((weak)) void TIMER1_COMPA_vect() {
+  TIMSK.v &= ~(1 << OCIE1A);
+}
+__attribute__((weak)) void PCINT0_vect() {}
+
+void nativeBusPins(byte bScl, byte bSda) {
+  bSclBit = bScl;
+  bSdaBit = bSda;
+}
+
+void delay(unsigned long) {}
+void delayMicroseconds(unsigned int) {}
+
+unsigned long micros() {
+  static std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - tStart).count();
+}
+
+unsigned long millis() {
+  return micros() / 1000;
+}
+
+int analogRead(uint8_t) {
+  return 1023; // encoder button released
+}
+
+void attachInterrupt(uint8_t, void (*)(), int) {}
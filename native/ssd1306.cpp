@@ -0,0 +1,274 @@
+// SSD1306 model: I2C slave, command decoder and GDDRAM. Covers what the
+// engine uses: page, horizontal and vertical addressing, the column and page
+// windows (0x21/0x22) and the display start line. Remap, contrast and the
+// like are accepted and ignored, frames come out in GDDRAM order.
+#include "ssd1306.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SSD1306_ADDR 0x78 // 0x3c, write
+
+SSD1306_STATS ssd1306Stats;
+uint8_t ssd1306Ram[8][128];
+uint8_t ssd1306StartLine;
+
+// Bus state
+static bool bLastScl = 1, bLastSda = 1, bInTx;
+static uint8_t bBits, bShift;
+static int iByte; // byte of the transaction, 0 is the address
+static bool bForUs;
+
+// Control byte state
+static uint8_t bControl;
+static bool bExpectControl;
+
+// Command and addressing state
+static uint8_t bCmd[7], bCmdLen, bCmdArgs;
+static uint8_t bMode = 2; // 0 horizontal, 1 vertical, 2 page
+static uint8_t bColStart, bColEnd = 127, bPageStart, bPageEnd = 7;
+static uint8_t bCol, bPage;
+
+void ssd1306Reset() {
+  memset(ssd1306Ram, 0, sizeof(ssd1306Ram));
+  memset(&ssd1306Stats, 0, sizeof(ssd1306Stats));
+  ssd1306StartLine = 0;
+  bMode = 2;
+  bColStart = 0;
+  bColEnd = 127;
+  bPageStart = 0;
+  bPageEnd = 7;
+  bCol = bPage = 0;
+  bCmdLen = 0;
+}
+
+// Argument bytes following each command
+static uint8_t CommandArgs(uint8_t c) {
+  switch (c) {
+  case 0x26: case 0x27:
+    return 6;
+  case 0x29: case 0x2a:
+    return 5;
+  case 0x21: case 0x22: case 0xa3:
+    return 2;
+  case 0x20: case 0x81: case 0x8d: case 0xa8: case 0xd3: case 0xd5:
+  case 0xd9: case 0xda: case 0xdb:
+    return 1;
+  }
+  return 0;
+}
+
+static void Command(uint8_t c) {
+  ssd1306Stats.ulCmdBytes++;
+  bCmd[bCmdLen++] = c;
+  if (bCmdLen == 1)
+    bCmdArgs = CommandArgs(c);
+  if (bCmdLen <= bCmdArgs)
+    return; // waiting for arguments
+  bCmdLen = 0;
+
+  c = bCmd[0];
+  if (c < 0x10) {
+    bCol = (bCol & 0xf0) | c; // page mode column, low nibble
+  } else if (c < 0x20) {
+    bCol = (bCol & 0x0f) | ((c & 0x0f) << 4);
+  } else if (c == 0x20) {
+    bMode = bCmd[1] & 3;
+  } else if (c == 0x21) {
+    bColStart = bCmd[1] & 127;
+    bColEnd = bCmd[2] & 127;
+    bCol = bColStart;
+  } else if (c == 0x22) {
+    bPageStart = bCmd[1] & 7;
+    bPageEnd = bCmd[2] & 7;
+    bPage = bPageStart;
+  } else if (c >= 0x40 && c < 0x80) {
+    ssd1306StartLine = c & 63;
+  } else if (c >= 0xb0 && c < 0xb8) {
+    bPage = c & 7;
+  }
+}
+
+static void Data(uint8_t d) {
+  ssd1306Stats.ulDataBytes++;
+  ssd1306Ram[bPage][bCol] = d;
+  if (bMode == 0) { // horizontal: across the window, then down
+    if (bCol == bColEnd) {
+      bCol = bColStart;
+      bPage = (bPage == bPageEnd) ? bPageStart : bPage + 1;
+    } else {
+      bCol = (bCol + 1) & 127;
+    }
+  } else if (bMode == 1) { // vertical: down the window, then across
+    if (bPage == bPageEnd) {
+      bPage = bPageStart;
+      bCol = (bCol == bColEnd) ? bColStart : bCol + 1;
+    } else {
+      bPage = (bPage + 1) & 7;
+    }
+  } else { // page: along the page, the page doesn't change
+    bCol = (bCol == bColEnd) ? bColStart : (bCol + 1) & 127;
+  }
+}
+
+static void GotByte(uint8_t b) {
+  if (iByte++ == 0) {
+    bForUs = (b == SSD1306_ADDR);
+    bExpectControl = 1;
+    return;
+  }
+  if (!bForUs)
+    return;
+  if (bExpectControl) {
+    bControl = b;
+    bExpectControl = 0;
+    return;
+  }
+  if (bControl & 0x80) // Co set: a single byte, then another control byte
+    bExpectControl = 1;
+  if (bControl & 0x40)
+    Data(b);
+  else
+    Command(b);
+}
+
+void ssd1306Bus(bool bScl, bool bSda) {
+  if (bScl && bLastScl && bSda != bLastSda) {
+    if (!bSda) { // START (or repeated START)
+      bInTx = 1;
+      bBits = 0;
+      iByte = 0;
+      bCmdLen = 0;
+      ssd1306Stats.ulTransactions++;
+    } else { // STOP
+      bInTx = 0;
+    }
+  } else if (bScl && !bLastScl && bInTx) {
+    ssd1306Stats.ulSclClocks++;
+    if (bBits < 8)
+      bShift = (bShift << 1) | bSda;
+    if (++bBits == 9) { // the 9th clock is the ACK
+      bBits = 0;
+      GotByte(bShift);
+    }
+  }
+  bLastScl = bScl;
+  bLastSda = bSda;
+}
+
+void ssd1306Screen(uint8_t out[8][128]) {
+  int r, x, src;
+
+  memset(out, 0, 8 * 128);
+  for (r = 0; r < 64; r++) {
+    src = (r + ssd1306StartLine) & 63;
+    for (x = 0; x < 128; x++) {
+      if (ssd1306Ram[src >> 3][x] & (1 << (src & 7)))
+        out[r >> 3][x] |= 1 << (r & 7);
+    }
+  }
+}
+
+// One row of the screen, 8 pixels per byte with the leftmost in bit 7
+static void ScreenRow(uint8_t screen[8][128], int r, uint8_t *d, bool bInvert) {
+  int x;
+
+  memset(d, 0, 16);
+  for (x = 0; x < 128; x++) {
+    if (((screen[r >> 3][x] >> (r & 7)) & 1) != bInvert)
+      d[x >> 3] |= 0x80 >> (x & 7);
+  }
+}
+
+bool ssd1306WritePBM(const char *szName) {
+  uint8_t screen[8][128], row[16];
+  FILE *f = fopen(szName, "wb");
+  int r;
+
+  if (!f)
+    return 0;
+  ssd1306Screen(screen);
+  fprintf(f, "P4\n128 64\n");
+  for (r = 0; r < 64; r++) {
+    ScreenRow(screen, r, row, 1); // 1 is black in PBM, lit pixels are white
+    fwrite(row, 1, sizeof(row), f);
+  }
+  return fclose(f) == 0;
+}
+
+// PNG ****************************************************************
+static uint32_t Crc32(uint32_t crc, const uint8_t *p, int iLen) {
+  int k;
+
+  crc = ~crc;
+  while (iLen--) {
+    crc ^= *p++;
+    for (k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static void Put32(uint8_t *d, uint32_t v) {
+  d[0] = v >> 24;
+  d[1] = v >> 16;
+  d[2] = v >> 8;
+  d[3] = v;
+}
+
+static void PngChunk(FILE *f, const char *szType, const uint8_t *pData, int iLen) {
+  uint8_t b[4];
+  uint32_t crc;
+
+  Put32(b, iLen);
+  fwrite(b, 1, 4, f);
+  fwrite(szType, 1, 4, f);
+  fwrite(pData, 1, iLen, f);
+  crc = Crc32(Crc32(0, (const uint8_t *)szType, 4), pData, iLen);
+  Put32(b, crc);
+  fwrite(b, 1, 4, f);
+}
+
+// 1 bit grayscale, the image data in a single stored (uncompressed) deflate
+// block, so no zlib is needed
+bool ssd1306WritePNG(const char *szName) {
+  static const uint8_t ucSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  uint8_t screen[8][128], ihdr[13], raw[64 * 17], idat[2 + 5 + sizeof(raw) + 4];
+  uint32_t a = 1, b = 0;
+  int r, i;
+  FILE *f = fopen(szName, "wb");
+
+  if (!f)
+    return 0;
+  ssd1306Screen(screen);
+  for (r = 0; r < 64; r++) {
+    raw[r * 17] = 0; // filter: none
+    ScreenRow(screen, r, &raw[r * 17 + 1], 0);
+  }
+  for (i = 0; i < (int)sizeof(raw); i++) { // Adler-32
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  Put32(ihdr, 128);
+  Put32(ihdr + 4, 64);
+  ihdr[8] = 1;  // bit depth
+  ihdr[9] = 0;  // grayscale
+  ihdr[10] = 0; // deflate
+  ihdr[11] = 0; // adaptive filtering
+  ihdr[12] = 0; // not interlaced
+  idat[0] = 0x78; // zlib header: deflate, 32K window
+  idat[1] = 0x01;
+  idat[2] = 1; // final stored block
+  idat[3] = sizeof(raw) & 0xff;
+  idat[4] = sizeof(raw) >> 8;
+  idat[5] = ~sizeof(raw) & 0xff;
+  idat[6] = (~sizeof(raw) >> 8) & 0xff;
+  memcpy(&idat[7], raw, sizeof(raw));
+  Put32(&idat[7 + sizeof(raw)], (b << 16) | a);
+
+  fwrite(ucSignature, 1, sizeof(ucSignature), f);
+  PngChunk(f, "IHDR", ihdr, sizeof(ihdr));
+  PngChunk(f, "IDAT", idat, sizeof(idat));
+  PngChunk(f, "IEND", NULL, 0);
+  return fclose(f) == 0;
+}
@@ -0,0 +1,28 @@
+// SSD1306 model for the native build: decodes the I2C bus from the SCL and
+// SDA levels, runs the addressing commands and keeps the 128x64 GDDRAM
+#ifndef SSD1306_MODEL_H
+#define SSD1306_MODEL_H
+
+#include <stdint.h>
+
+typedef struct tag_ssd1306_stats {
+  unsigned long ulTransactions; // START conditions
+  unsigned long ulCmdBytes;     // bytes after a command control byte
+  unsigned long ulDataBytes;    // bytes written to GDDRAM
+  unsigned long ulSclClocks;    // SCL rising edges, 9 per byte
+} SSD1306_STATS;
+
+extern SSD1306_STATS ssd1306Stats;
+extern uint8_t ssd1306Ram[8][128]; // GDDRAM, page by column
+extern uint8_t ssd1306StartLine;   // 0x40..0x7f
+
+void ssd1306Reset();
+// New bus levels (high = released), call on every pin change
+void ssd1306Bus(bool bScl, bool bSda);
+// The screen as seen: GDDRAM rows rotated by the display start line
+void ssd1306Screen(uint8_t out[8][128]);
+// Write the screen as a binary PBM or a 1 bit PNG, false on I/O errors
+bool ssd1306WritePBM(const char *szName);
+bool ssd1306WritePNG(const char *szName);
+
+#endif
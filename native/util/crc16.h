@@ -0,0 +1,13 @@
+// Host stand-in for util/crc16.h, the C version from the avr-libc manual
+#ifndef NATIVE_CRC16_H
+#define NATIVE_CRC16_H
+
+#include <stdint.h>
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+  data ^= crc & 0xff;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif
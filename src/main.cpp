@@ -6,20 +6,137 @@
 //#include <stdbool.h>
 
 #include <string.h> // memset()
+#include <util/crc16.h> // _crc_ccitt_update()
 
 #ifdef DEBUG
 //#include "ATtinySerialOut.h"
 #endif
 
+// Engine options **********************************************
+// I2C transport: the USI in two-wire mode instead of bit-banging PORTB.
+// The USI pins are fixed (SCL PB2, SDA PB0), so the encoder moves to PB3.
+// env:attiny85_usi sets it together with the serial TX pin for BENCHMARK.
+//#define I2C_USI
+
+// Vertical scroll through the SSD1306 display start line: the 8 GDDRAM pages
+// are used as a ring buffer, so a 1px vertical step only resends one page.
+// Draws no sprites, Mario included: only the pages the scroll changes are
+// sent, and nothing would redraw the ones a sprite moved on.
+//#define OLED_HW_SCROLL
+
+// Send each page from a Timer1 interrupt while the next one is composed
+// (double buffered, needs 128 bytes more RAM than the synchronous path)
+//#define OLED_ASYNC
+
+// Horizontal addressing mode: the column/page window is set once and the
+// pages of a frame stream out in a single data transaction
+//#define OLED_FRAME_PUSH
+
+// Skip pages whose content didn't change since they were last sent
+// (16 bit signature per page)
+//#define OLED_PAGE_SKIP
+
+// Store tileMap run length encoded, one row at a time (include/tilemap_rle.h,
+// generated from tileMap with tools/maprle.py). Rows decode straight into
+// bPlayfield while streaming.
+//#define MAP_RLE
+
+// Store tileMap as 2x2 metatiles (include/tilemap_meta.h, generated from
+// tileMap with tools/metatiles.py), expanded while streaming. Can't be
+// combined with MAP_RLE.
+//#define MAP_METATILES
+
+// Tile and sprite kernels specialized per vertical offset (constant shift
+// counts), picked from a table instead of shifting by a variable. Costs flash
+// for 8 tile kernels and 8 sprite blitters.
+//#define SPECIALIZED_KERNELS
+
+// Send only the changed column span of a page: one signature per 16 column
+// slot instead of per page (128 bytes of RAM), implies OLED_PAGE_SKIP.
+// Can't be combined with OLED_ASYNC: with its second page buffer the RAM
+// is gone before the stack gets any.
+//#define OLED_DIRTY_SPAN
+
+// Compose each column byte from tiles and sprites and send it straight to
+// the display, without the 128 byte page buffer. Can't be combined with
+// OLED_ASYNC, OLED_PAGE_SKIP or OLED_HW_SCROLL, which all need whole pages.
+// At most 4 sprites per page (SPRITE_BUDGET if set) are composed, a page
+// with more draws them in turns, like SPRITE_BUDGET's overloaded pages.
+//#define OLED_STREAM
+
+// Per page sprite budget, in units of 8 columns (a 16 wide sprite counts
+// twice). A page with more sprites draws as many as fit (at least one, which
+// may go over) and starts with the ones left out on the next frame, so
+// overloaded pages flicker instead of running long.
+//#define SPRITE_BUDGET 4
+
+// Run the benchmarks at startup, results are printed with 115200 baud on the
+// serial TX pin (PB0, or PB4 when the USI owns PB0: -D TX_PIN=PB4)
+//#define BENCHMARK
+// With BENCHMARK: exact cycle counts from the simavr runner in tools/simbench
+// instead of micros(), the firmware stops when the benchmarks are done
+//#define BENCHMARK_SIMAVR
+
+#ifdef OLED_DIRTY_SPAN
+#define OLED_PAGE_SKIP
+#endif
+
+#if defined(MAP_RLE) && defined(MAP_METATILES)
+#error "MAP_RLE and MAP_METATILES are two formats of the same map, pick one"
+#endif
+
+#if defined(OLED_STREAM) && (defined(OLED_ASYNC) || defined(OLED_PAGE_SKIP) || defined(OLED_HW_SCROLL))
+#error "OLED_STREAM can't be combined with OLED_ASYNC, OLED_PAGE_SKIP or OLED_HW_SCROLL"
+#endif
+
+#if defined(OLED_DIRTY_SPAN) && defined(OLED_ASYNC)
+#error "OLED_DIRTY_SPAN and OLED_ASYNC don't fit in 512 bytes of RAM together"
+#endif
+
+#ifdef BENCHMARK
+#include "ATtinySerialOut.h" // TX_PIN comes from build_flags, the library is built with it too
+#if defined(I2C_USI) && TX_PIN != PB4
+#error "the USI owns PB0: build with -D TX_PIN=PB4 (env:attiny85_usi)"
+#endif
+#if defined(__AVR__) && MAX_OBJECTS > 8
+#error "benchSprites() runs out of RAM with more than 8 objects, 16 and 32 are for the native build"
+#endif
+#ifdef BENCHMARK_SIMAVR
+#include <avr/sleep.h>
+#endif
+
+// Cycle counter for the benchmarks. tools/simbench latches its cycle count
+// on a write to GPIOR0 and hands it out a byte per read, low byte first.
+static unsigned long benchClock() {
+#ifdef BENCHMARK_SIMAVR
+  unsigned long c;
+
+  GPIOR0 = 0;
+  c = GPIOR0;
+  c |= (unsigned long)GPIOR0 << 8;
+  c |= (unsigned long)GPIOR0 << 16;
+  c |= (unsigned long)GPIOR0 << 24;
+  return c;
+#else
+  return micros() * (F_CPU / 1000000L);
+#endif
+}
+#endif
+
 typedef uint8_t byte;
 
 // Timming **********************************************
 const int DELAY = 100;
 
 // OLED Screen config **********************************************
+#ifdef I2C_USI
+#define SSD1306_SCL PORTB2 // USCK/SCL, Pin 7
+#define SSD1306_SDA PORTB0 // DI/SDA, Pin 5
+#else
 // Changing defaults for avoid conflicts with interruptions
 #define SSD1306_SCL PORTB4 // SCL, Pin 3
 #define SSD1306_SDA PORTB3 // SDA, Pin 2
+#endif
 #define SSD1306_SA 0x3C // Slave Address
 
 // Screen resolution 128x64px
@@ -35,11 +152,17 @@ const int DELAY = 100;
 #define PLAYFIELD_ROWS (VIEWPORT_HEIGHT + EDGES) // AXIS Y: horizontal rows, map height size; min 8+2 (SCREEN_HEIGHT / 8) + Edges
 #define PLAYFIELD_COLS (VIEWPORT_WIDTH + EDGES) // AXIS X: vertical cols, map width size; min 16+2 (SCREEN_WIDTH / 8) + Edges
 
+// World map in tiles, any size: bPlayfield streams the visible part of it
+// and the world wraps around at its edges
 #define TILEMAP_HEIGHT 29
-#define TILEMAP_WIDTH PLAYFIELD_COLS
+#define TILEMAP_WIDTH 18
 
 // Rotary encoder **********************************************
+#ifdef I2C_USI
+const int EncoderA = 3; // PB3, pin 2 (PCINT3)
+#else
 const int EncoderA = 2; // PB2, pin 7 (INT0)
+#endif
 const int EncoderB = 1; // PB1, pin 6
 const int EncoderClick = A0; // A0 PB5, pin 1 (RESET)
 volatile int a0;
@@ -68,31 +191,79 @@ void reloadPlayField();
 void adjustPlayField();
 
 typedef struct tag_gfx_object {
-  byte x;
-  byte y;
-  byte bType; // type and index (high bit set = 16x16, else 8x8), up to 128
-              // unique sprites
+  int x; // world pixels, see iViewX/iViewY
+  int y;
+  byte bType; // index in spriteTable, up to 256 unique sprites
+  byte bFlags; // SPRITE_FLIP_H, SPRITE_FLIP_V, blend mode
 } GFX_OBJECT;
 
+#define SPRITE_FLIP_H 0x01 // mirrored left to right
+#define SPRITE_FLIP_V 0x02 // mirrored top to bottom
+// Blend modes that don't read the mask (default: background & mask | pattern)
+#define SPRITE_OPAQUE 0x04 // the pattern replaces the sprite's rectangle
+#define SPRITE_XOR 0x08    // the pattern inverts the background, wins over OPAQUE
+
 static byte bPlayfield[PLAYFIELD_ROWS * PLAYFIELD_COLS];
 static int iScrollX, iScrollY;
-
-const int numberOfSprites = 1;
+// World tiles held by bPlayfield: HELD_ROWS rows from uiRowTop and
+// HELD_COLS columns from uiColLeft, the viewport plus its partial row and
+// column. World tile (x, y) lives at bPlayfield row y % PLAYFIELD_ROWS,
+// column x % PLAYFIELD_COLS.
+#define HELD_ROWS (VIEWPORT_HEIGHT + 1)
+#define HELD_COLS (VIEWPORT_WIDTH + 1)
+static bool bPlayfieldValid = 0;
+static unsigned int uiRowTop, uiColLeft;
+unsigned int uiRowsStreamed, uiColsStreamed; // counters for profiling
+
+// Room for this many objects: 6 bytes of RAM each, plus MAX_SPRITE_PAGES + 1
+// bytes of page buckets (a sprite off the page grid covers one more page)
+#ifndef MAX_OBJECTS
+#define MAX_OBJECTS 1
+#endif
+const int numberOfSprites = MAX_OBJECTS;
+static byte bObjects; // objects in use, from the start of object_list
 
 // Objects and sprites **********************************************
 // active objects (can be any number which fits in RAM)
 static GFX_OBJECT object_list[numberOfSprites];
+// World pixel at the top left of the screen, set by DrawPlayfield(). Objects
+// share the unwrapped space of iScrollX/iScrollY, a game that wraps the
+// scroll position moves its objects along with it.
+static int iViewX, iViewY;
+
+// Sprite shapes: bPages rows of bWidth bytes (one byte is 8 vertical pixels)
+// of mask and as many of pattern, at their offsets in ucSprites. Any width
+// up to 128, any height in multiples of 8 up to MAX_SPRITE_PAGES pages.
+typedef struct tag_sprite_desc {
+  byte bWidth;
+  byte bPages;
+  unsigned int uiMask;
+  unsigned int uiPattern;
+} SPRITE_DESC;
+
+#define MAX_SPRITE_PAGES 2 // tallest entry of spriteTable, sizes the page buckets
+
+#define SPRITE_PHANTOM 0
+#define SPRITE_MARIO 1
+// constexpr, so the build can check every entry against MAX_SPRITE_PAGES
+constexpr SPRITE_DESC spriteTable[] PROGMEM = {
+  {8, 1, 0, 8},    // 8x8px phantom (Pac Man)
+  {16, 2, 16, 48}, // 16x16px Mario Bros
+};
+
+// True when entries i.. of spriteTable are at most MAX_SPRITE_PAGES tall
+constexpr bool SpritesFitBuckets(unsigned int i = 0) {
+  return i == sizeof(spriteTable) / sizeof(spriteTable[0]) ||
+         (spriteTable[i].bPages <= MAX_SPRITE_PAGES && SpritesFitBuckets(i + 1));
+}
+static_assert(SpritesFitBuckets(), "a spriteTable entry is taller than MAX_SPRITE_PAGES, raise it");
 
-// 8x8px sprite: phantom (Pac Man)
-// 8 bytes of mask followed by 8 bytes of pattern
 const byte ucSprites[] PROGMEM = {
+  // phantom: 8 bytes of mask followed by 8 bytes of pattern
+  0x7C, 0xF6, 0x66, 0xFF, 0x7F, 0xF6, 0x66, 0xFC,
   0x7C, 0xF6, 0x66, 0xFF, 0x7F, 0xF6, 0x66, 0xFC,
-  0x7C, 0xF6, 0x66, 0xFF, 0x7F, 0xF6, 0x66, 0xFC
-};
 
-// 16x16px Mario Bros
-// 32 bytes of mask followed by 32 bytes of pattern
-const byte ucBigSprites[] PROGMEM = {
+  // Mario: 32 bytes of mask followed by 32 bytes of pattern
   0xff, 0xff, 0xff, 0x0f, 0x07, 0x03, 0x03, 0x03,
   0x03, 0x03, 0x07, 0x07, 0xaf, 0xff, 0xff, 0xff,
   0xff, 0x73, 0x21, 0x00, 0x00, 0x00, 0x00, 0x80,
@@ -130,6 +301,21 @@ const byte ucTiles[] PROGMEM = {
     0x8a, 0x00, 0x2a, 0x00, 0x8a, 0x00, 0x2a, 0x00, // Gradient 75-25% (17)
 };
 
+#ifdef MAP_RLE
+#include "tilemap_rle.h"
+#if MAP_RLE_HEIGHT != TILEMAP_HEIGHT || MAP_RLE_WIDTH != TILEMAP_WIDTH
+#error "include/tilemap_rle.h doesn't match tileMap, run tools/maprle.py again"
+#endif
+#elif defined(MAP_METATILES)
+#include "tilemap_meta.h"
+#if MAP_META_HEIGHT != TILEMAP_HEIGHT || MAP_META_WIDTH != TILEMAP_WIDTH
+#error "include/tilemap_meta.h doesn't match tileMap, run tools/metatiles.py again"
+#endif
+#endif
+
+// The plain map, the source of the generated ones. MAP_KEEP_TILEMAP keeps
+// it next to them: the native build checks the rendering against it.
+#if !(defined(MAP_RLE) || defined(MAP_METATILES)) || defined(MAP_KEEP_TILEMAP)
 // TIENE QUE TENER EL MISMO NUM. DE FILAS EXACTAS QUE INDICA EL ARRAY, SI PONE 10, 10 FILAS!
 const byte tileMap[TILEMAP_HEIGHT][TILEMAP_WIDTH] PROGMEM = {
   /* 00 */ {0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0},
@@ -163,6 +349,7 @@ const byte tileMap[TILEMAP_HEIGHT][TILEMAP_WIDTH] PROGMEM = {
   /* 28 */ {0,  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0},
   /* 29 */ {0,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  1,  0},
 };
+#endif
 
 // some globals
 static int iScreenOffset; // current write offset of screen data
@@ -175,6 +362,61 @@ static void oledWriteCommand(unsigned char c);
 // A bit set to 1 in the DDR is an output, 0 is an INPUT
 #define I2CDDR DDRB
 
+#ifdef I2C_USI
+// USI two-wire master (AVR310). SCL edges are software strobes of USITC, the
+// shift register and the SDA output latch do the per-bit work.
+#define USI_CLOCK ((1 << USIWM1) | (1 << USICS1) | (1 << USICLK) | (1 << USITC))
+#define USI_STATUS ((1 << USISIF) | (1 << USIOIF) | (1 << USIPF) | (1 << USIDC))
+#define USI_8BITS (USI_STATUS | (0x0 << USICNT0))
+#define USI_1BIT (USI_STATUS | (0xE << USICNT0))
+
+// Clock USIDR out until the 4 bit counter overflows (2 edges per bit)
+static inline void usiTransfer(byte bStatus) {
+  USISR = bStatus;
+  do {
+    delayMicroseconds(SAFE_DELAY);
+    USICR = USI_CLOCK; // SCL high
+    delayMicroseconds(SAFE_DELAY);
+    USICR = USI_CLOCK; // SCL low
+  } while (!(USISR & (1 << USIOIF)));
+}
+
+// Transmit a byte and ack bit
+static inline void i2cByteOut(byte b) {
+  USIDR = b;
+  usiTransfer(USI_8BITS);
+  USIDR = 0; // ACK bit driven low, same as the bit-banged version
+  usiTransfer(USI_1BIT);
+}
+
+void i2cBegin(byte addr) {
+  I2CPORT |= ((1 << SSD1306_SDA) + (1 << SSD1306_SCL));
+  I2CDDR |= ((1 << SSD1306_SDA) + (1 << SSD1306_SCL));
+  USIDR = 0xff;
+  USICR = USI_CLOCK & ~(1 << USITC);
+  USISR = USI_8BITS;
+  I2CPORT &= ~(1 << SSD1306_SDA); // data line low first
+  delayMicroseconds(SAFE_DELAY);
+  I2CPORT &= ~(1 << SSD1306_SCL); // then clock line low is a START signal
+  I2CPORT |= (1 << SSD1306_SDA);  // SDA is driven by the USI from now on
+  i2cByteOut(addr << 1);          // send the slave address
+}
+
+void i2cWrite(byte *pData, byte bLen) {
+  while (bLen--) {
+    i2cByteOut(*pData++);
+  }
+}
+
+// Send I2C STOP condition
+void i2cEnd() {
+  I2CPORT &= ~(1 << SSD1306_SDA);
+  USIDR = 0xff; // the output latch would keep SDA low otherwise
+  I2CPORT |= (1 << SSD1306_SCL);
+  delayMicroseconds(SAFE_DELAY);
+  I2CPORT |= (1 << SSD1306_SDA);
+}
+#else
 // Transmit a byte and ack bit
 static inline void i2cByteOut(byte b) {
   byte i;
@@ -258,15 +500,106 @@ void i2cEnd() {
   I2CPORT |= (1 << SSD1306_SDA);
   I2CDDR &= ((1 << SSD1306_SDA) | (1 << SSD1306_SCL)); // let the lines float (tri-state)
 }
+#endif
+
+#ifdef OLED_ASYNC
+// Async page transmitter **********************************************
+// The data bytes of a page go out in chunks from the Timer1 compare
+// interrupt; the CPU composes the next page in between.
+#define ASYNC_CHUNK 8   // bytes sent per interrupt
+#define ASYNC_PERIOD 16 // Timer1 ticks (CK/64, 8us at 8MHz) between chunks
+
+static byte bPages[2][SCREEN_WIDTH]; // page on the wire / page being composed
+static byte *pAsyncPage;             // last page handed to the transmitter
+static byte *volatile pAsyncData;    // next byte to send, NULL when idle
+static volatile byte bAsyncLen;
+#ifdef BENCHMARK
+static unsigned long ulAsyncWait; // cycles spent waiting for the transmitter
+#endif
+
+ISR(TIMER1_COMPA_vect) {
+  byte *p = pAsyncData;
+  byte bLen = (bAsyncLen < ASYNC_CHUNK) ? bAsyncLen : ASYNC_CHUNK;
+
+  i2cWrite(p, bLen);
+  bAsyncLen -= bLen;
+  if (bAsyncLen) {
+    pAsyncData = p + bLen;
+  } else {
+#ifndef OLED_FRAME_PUSH
+    i2cEnd(); // a frame push stream stays open for the next page
+#endif
+    TIMSK &= ~(1 << OCIE1A);
+    pAsyncData = NULL;
+  }
+}
+
+// Timer1 in CTC mode, the interrupt is only enabled while a page is queued
+static void oledAsyncInit() {
+  TCCR1 = (1 << CTC1) | (1 << CS12) | (1 << CS11) | (1 << CS10); // CK/64
+  OCR1A = ASYNC_PERIOD;
+  OCR1C = ASYNC_PERIOD;
+}
+
+// Block until the queued page is on the display
+static void oledWaitIdle() {
+#ifdef BENCHMARK
+  unsigned long t = benchClock();
+#endif
+  while (pAsyncData)
+    ;
+#ifdef BENCHMARK
+  ulAsyncWait += benchClock() - t;
+#endif
+}
+
+// Start sending a page, the data transaction must already be open
+static void oledQueuePage(byte *pData) {
+  oledWaitIdle();
+  pAsyncPage = pData;
+  bAsyncLen = SCREEN_WIDTH;
+  pAsyncData = pData;
+  TCNT1 = 0;
+  TIFR = (1 << OCF1A);
+  TIMSK |= (1 << OCIE1A);
+}
+
+// Page buffer to compose into: always the one that isn't on the wire
+static byte *oledPageBuffer() {
+  return (pAsyncPage == bPages[0]) ? bPages[1] : bPages[0];
+}
+#endif
+
+#ifdef OLED_FRAME_PUSH
+#define STREAM_CLOSED 0xff
+static byte bStreamPage = STREAM_CLOSED; // page the open data transaction writes next
+static byte bStreamTop; // first page of its window, where it wraps to after page 7
+#endif
+
+// Let the async transmitter finish and close an open data stream before
+// another transaction starts
+static void oledFlush() {
+#ifdef OLED_ASYNC
+  oledWaitIdle();
+#endif
+#ifdef OLED_FRAME_PUSH
+  if (bStreamPage != STREAM_CLOSED) {
+    i2cEnd();
+    bStreamPage = STREAM_CLOSED;
+  }
+#endif
+}
 
 // Wrapper function to write I2C data on Arduino
 static void I2CWrite(unsigned char *pData, int iLen) {
+  oledFlush();
   i2cBegin(SSD1306_SA);
   i2cWrite(pData, iLen);
   i2cEnd();
 }
 
 static void I2CWriteData(unsigned char *pData, int iLen) {
+  oledFlush();
   i2cBegin(SSD1306_SA);
   i2cByteOut(0x40);
   i2cWrite(pData, iLen);
@@ -294,7 +627,11 @@ void oledInit(int bFlip, int bInvert) {
 
       /*0x21, 0x00, 0x7f, 0x22, 0x00, 0x07,*/
 
+#ifdef OLED_FRAME_PUSH
+      0x20, 0x00  // Set memory addressing mode [0x00 - Horizontal, 0x01 - Verticial, 0x02 - Page]
+#else
       0x20, 0x02  // Set memory addressing mode [0x00 - Horizontal, 0x01 - Verticial, 0x02 - Page]
+#endif
   };
 
   I2CDDR &= ~(1 << SSD1306_SDA);
@@ -347,15 +684,157 @@ void oledSetContrast(unsigned char ucContrast) {
   oledWriteCommand2(0x81, ucContrast);
 }
 
+#ifdef OLED_FRAME_PUSH
+// Set the column/page window of horizontal addressing mode (one transaction)
+static void oledSetWindow(byte x0, byte x1, byte y0, byte y1) {
+  unsigned char buf[7];
+
+  buf[0] = 0x00;
+  buf[1] = 0x21; // column start/end
+  buf[2] = x0;
+  buf[3] = x1;
+  buf[4] = 0x22; // page start/end
+  buf[5] = y0;
+  buf[6] = y1;
+  I2CWrite(buf, 7);
+}
+#endif
+
 // Send commands to position the "cursor" (aka memory write address)
 // to the given row and column
 static void oledSetPosition(int x, int y) {
+#ifdef OLED_FRAME_PUSH
+  // page addressing commands are ignored in horizontal mode
+  oledSetWindow(x, SCREEN_WIDTH - 1, y, VIEWPORT_HEIGHT - 1);
+#else
   oledWriteCommand(0xb0 | y);                // go to page Y
   oledWriteCommand(0x00 | (x & 0xf));        // lower col addr
   oledWriteCommand(0x10 | ((x >> 4) & 0xf)); // upper col addr
+#endif
   iScreenOffset = (y * SCREEN_WIDTH) + x;
 }
 
+#ifdef OLED_PAGE_SKIP
+// Page change detection **********************************************
+// A 16 bit signature does collide now and then (~1 in 65536 changed pages),
+// so every PAGE_REFRESH-th page is sent anyway. The count is odd to rotate
+// the forced resend over the 8 pages: a stale page lasts at most 8 * 127
+// pages (~4 seconds at 30fps) and idle frames cost ~8 bytes on average.
+#define PAGE_REFRESH 127
+
+// With OLED_DIRTY_SPAN the signatures are kept per slot of 16 columns, so
+// the leftmost and rightmost changed slots give the span to send. 16 bit
+// per 16 columns rather than 8 bit per 8 columns: same RAM, and a 1 in 256
+// collision on the edge of a moving sprite would leave stale slivers.
+#ifdef OLED_DIRTY_SPAN
+#define SIG_SLOTS 8
+#else
+#define SIG_SLOTS 1
+#endif
+#define SIG_SLOT_WIDTH (SCREEN_WIDTH / SIG_SLOTS)
+
+static unsigned int uiPageSig[VIEWPORT_HEIGHT][SIG_SLOTS]; // what each GDDRAM page holds
+static byte bPageSigValid;                // one bit per page
+static byte bPageRefresh;                 // pages until a forced resend
+unsigned int uiPagesSent, uiPagesSkipped; // counters for profiling
+
+// CRC-16 of one slot of a composed page, ~13 cycles per byte with the
+// avr-libc helper
+static unsigned int oledSlotSignature(byte *pData) {
+  unsigned int uiSig = 0xffff;
+  byte i;
+
+  for (i = 0; i < SIG_SLOT_WIDTH; i++) {
+    uiSig = _crc_ccitt_update(uiSig, *pData++);
+  }
+  return uiSig;
+}
+
+// Forget the signatures after the display was written some other way
+static void oledInvalidatePages() {
+  bPageSigValid = 0;
+}
+#endif
+
+// Write a full page to the display, unconditionally.
+// With OLED_FRAME_PUSH, consecutive pages share one data transaction which
+// stays open until something else needs the bus: a full frame costs no
+// commands at all once the window is set. With OLED_ASYNC the data goes
+// out from the Timer1 interrupt, so pData must come from oledPageBuffer().
+static void oledWritePage(byte y, byte *pData) {
+#ifdef OLED_FRAME_PUSH
+  if (y != bStreamPage) {
+    oledFlush();
+    oledSetWindow(0, SCREEN_WIDTH - 1, y, VIEWPORT_HEIGHT - 1);
+    i2cBegin(SSD1306_SA);
+    i2cByteOut(0x40);
+    bStreamTop = y;
+  }
+  bStreamPage = (y == VIEWPORT_HEIGHT - 1) ? bStreamTop : y + 1;
+#ifdef OLED_ASYNC
+  oledQueuePage(pData);
+#else
+  i2cWrite(pData, SCREEN_WIDTH);
+#endif
+#elif defined(OLED_ASYNC)
+  oledSetPosition(0, y); // waits for the previous page
+  i2cBegin(SSD1306_SA);
+  i2cByteOut(0x40);
+  oledQueuePage(pData);
+#else
+  oledSetPosition(0, y);
+  I2CWriteData(pData, SCREEN_WIDTH);
+#endif
+}
+
+// Send a full page to the display, as oledWritePage().
+// With OLED_PAGE_SKIP, a page identical to the one already on the display
+// is not sent at all. With OLED_DIRTY_SPAN only the span between the first
+// and the last changed slot is sent, positioned through the column window
+// (0x21) in frame push mode or the page mode column address otherwise.
+static void oledSendPage(byte y, byte *pData) {
+#ifdef OLED_PAGE_SKIP
+  byte i, bFirst = SIG_SLOTS;
+#ifdef OLED_DIRTY_SPAN
+  byte bLast = 0;
+#endif
+  bool bForce = !(bPageSigValid & (1 << y));
+  unsigned int uiSig;
+
+  if (++bPageRefresh == PAGE_REFRESH) {
+    bPageRefresh = 0;
+    bForce = 1;
+  }
+  for (i = 0; i < SIG_SLOTS; i++) {
+    uiSig = oledSlotSignature(pData + i * SIG_SLOT_WIDTH);
+    if (bForce || uiPageSig[y][i] != uiSig) {
+      uiPageSig[y][i] = uiSig;
+      if (bFirst == SIG_SLOTS)
+        bFirst = i;
+#ifdef OLED_DIRTY_SPAN
+      bLast = i;
+#endif
+    }
+  }
+  bPageSigValid |= (1 << y);
+
+  if (bFirst == SIG_SLOTS) {
+    uiPagesSkipped++;
+    return;
+  }
+  uiPagesSent++;
+
+#ifdef OLED_DIRTY_SPAN
+  if (bFirst != 0 || bLast != SIG_SLOTS - 1) {
+    oledSetPosition(bFirst * SIG_SLOT_WIDTH, y); // closes a frame push stream
+    I2CWriteData(pData + bFirst * SIG_SLOT_WIDTH, (bLast + 1 - bFirst) * SIG_SLOT_WIDTH);
+    return;
+  }
+#endif
+#endif
+  oledWritePage(y, pData);
+}
+
 // Fill the frame buffer with a byte pattern
 // e.g. all off (0x00) or all on (0xff)
 // TODO: Revisar esto porque no me cuadran los bucles
@@ -370,6 +849,19 @@ void oledFill(unsigned char ucData) {
       I2CWriteData(temp, 16);
     }
   }
+#ifdef OLED_PAGE_SKIP
+  oledInvalidatePages();
+#endif
+}
+
+// Funnel shift: low byte of ((hi << 8) | lo) >> n, 0 < n < 8. The ATtiny85
+// has no hardware multiplier, so both halves come out of a single 16 bit
+// shift done in whichever direction is shorter (at most 4 steps).
+static inline byte FunnelShift(byte lo, byte hi, byte n) {
+  unsigned int w = ((unsigned int)hi << 8) | lo;
+  if (n <= 4)
+    return (byte)(w >> n);
+  return (byte)((w << (8 - n)) >> 8);
 }
 
 // Draw 1 character space that's vertically shifted
@@ -378,256 +870,635 @@ void DrawShiftedChar(byte *s1, byte *s2, byte *d, byte bXOff, byte bYOff) {
 
   for (z = 0; z < (8 - bXOff); z++) {
     c = pgm_read_byte(s1++);
-    c >>= bYOff; // shift over
     c2 = pgm_read_byte(s2++);
-    c2 <<= (8 - bYOff);
-    *d++ = (c | c2);
+    *d++ = FunnelShift(c, c2, bYOff);
+  }
+}
+
+// Stand-in for a sprite row above or below the sprite: mask 0xff, pattern 0
+const byte ucBlankRow[2] PROGMEM = {0xff, 0x00};
+
+// Bit order reversal, a nibble at a time
+const byte ucNibbleReverse[16] PROGMEM = {
+  0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+  0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf};
+
+static inline byte BitReverse(byte b) {
+  return (pgm_read_byte(&ucNibbleReverse[b & 15]) << 4) | pgm_read_byte(&ucNibbleReverse[b >> 4]);
+}
+
+// A sprite on one page: the source row whose top lands in the page (Hi) and
+// the one above it (Lo). Column k of a row is read at (k & bLoK) / (k & bHiK),
+// a missing row has a zero index mask and points to ucBlankRow.
+typedef struct tag_sprite_span {
+  byte x, bWidth, bYOff, bFlags;
+  byte bLast;      // last source column, for SPRITE_FLIP_H
+  byte bLoK, bHiK; // 0xff, or 0 for a missing row
+  byte bKeep;      // SPRITE_OPAQUE: background bits outside the sprite
+  byte *sLoM, *sLoP, *sHiM, *sHiP; // mask and pattern of each row
+} SPRITE_SPAN;
+
+// Set up the span of a sprite on the page starting at line y, false if the
+// sprite isn't on that page. Clipping happens here: a sprite cut by the left
+// edge starts its row pointers (or, flipped, its last column) further in, so
+// reading the columns needs no tests. SPRITE_FLIP_V picks the mirrored rows
+// (their bits still need reversing).
+static bool SpriteSpan(GFX_OBJECT *pObject, byte y, SPRITE_SPAN *p) {
+  SPRITE_DESC desc;
+  int sx, sy;
+  byte k, bLo, bHi, bFirst = 0;
+
+  memcpy_P(&desc, &spriteTable[pObject->bType], sizeof(desc));
+  sx = pObject->x - iViewX;
+  sy = pObject->y - iViewY;
+  if (sy >= y + 8 || sy + desc.bPages * 8 <= y || sx >= SCREEN_WIDTH || sx + desc.bWidth <= 0)
+    return 0;
+  if (sx < 0) { // off the left edge
+    bFirst = -sx;
+    sx = 0;
+  }
+  p->x = sx;
+  p->bWidth = desc.bWidth - bFirst;
+  if (SCREEN_WIDTH - sx < p->bWidth) // off the right edge
+    p->bWidth = SCREEN_WIDTH - sx;
+  p->bYOff = sy & 7;
+  p->bFlags = pObject->bFlags;
+  p->bLast = desc.bWidth - 1 - bFirst;
+
+  // pages above and below the screen are never asked for, which clips the
+  // top and bottom edges
+  k = (y - (sy & ~7)) >> 3; // 0 .. bPages
+  if (pObject->bFlags & SPRITE_FLIP_V) {
+    bLo = desc.bPages - k;
+    bHi = desc.bPages - 1 - k;
+  } else {
+    bLo = k - 1;
+    bHi = k;
+  }
+  if (pObject->bFlags & SPRITE_FLIP_H)
+    bFirst = 0; // taken off bLast instead
+  if (k == 0) {
+    p->bLoK = 0;
+    p->sLoM = (byte *)&ucBlankRow[0];
+    p->sLoP = (byte *)&ucBlankRow[1];
+  } else {
+    p->bLoK = 0xff;
+    p->sLoM = (byte *)&ucSprites[desc.uiMask + bLo * desc.bWidth + bFirst];
+    p->sLoP = (byte *)&ucSprites[desc.uiPattern + bLo * desc.bWidth + bFirst];
+  }
+  if (k == desc.bPages) {
+    p->bHiK = 0;
+    p->sHiM = (byte *)&ucBlankRow[0];
+    p->sHiP = (byte *)&ucBlankRow[1];
+  } else {
+    p->bHiK = 0xff;
+    p->sHiM = (byte *)&ucSprites[desc.uiMask + bHi * desc.bWidth + bFirst];
+    p->sHiP = (byte *)&ucSprites[desc.uiPattern + bHi * desc.bWidth + bFirst];
+  }
+  p->bKeep = FunnelShift(~p->bLoK, ~p->bHiK, 8 - p->bYOff);
+  return 1;
+}
+
+// Blend column k of a span into the background byte c
+static inline byte SpanBlend(SPRITE_SPAN *p, byte k, byte c) {
+  byte mask = 0, cNew, maskLo = 0, cLo = 0;
+  bool bMasked = !(p->bFlags & (SPRITE_OPAQUE | SPRITE_XOR));
+
+  if (p->bFlags & SPRITE_FLIP_H)
+    k = p->bLast - k; // columns right to left
+  cNew = pgm_read_byte(p->sHiP + (k & p->bHiK));
+  if (bMasked)
+    mask = pgm_read_byte(p->sHiM + (k & p->bHiK));
+  if (p->bYOff) {
+    cLo = pgm_read_byte(p->sLoP + (k & p->bLoK));
+    if (bMasked)
+      maskLo = pgm_read_byte(p->sLoM + (k & p->bLoK));
+  }
+  if (p->bFlags & SPRITE_FLIP_V) { // bits bottom to top
+    cNew = BitReverse(cNew);
+    cLo = BitReverse(cLo);
+    if (bMasked) {
+      mask = BitReverse(mask);
+      maskLo = BitReverse(maskLo);
+    }
+  }
+  if (p->bYOff) {
+    mask = FunnelShift(maskLo, mask, 8 - p->bYOff);
+    cNew = FunnelShift(cLo, cNew, 8 - p->bYOff);
+  }
+  if (p->bFlags & SPRITE_XOR)
+    return c ^ cNew;
+  if (!bMasked)
+    mask = p->bKeep;
+  return (c & mask) | cNew;
+}
+
+#ifdef SPECIALIZED_KERNELS
+// Tile kernels: one per vertical offset, the shift count is a constant
+typedef void (*CHAR_KERNEL)(byte *s1, byte *s2, byte *d, byte bXOff);
+
+template <byte YOFF>
+static void DrawCharKernel(byte *s1, byte *s2, byte *d, byte bXOff) {
+  byte z;
+
+  for (z = 0; z < (8 - bXOff); z++) {
+    if (YOFF == 0)
+      *d++ = pgm_read_byte(s1++);
+    else
+      *d++ = FunnelShift(pgm_read_byte(s1++), pgm_read_byte(s2++), YOFF);
   }
 }
 
+const CHAR_KERNEL pCharKernels[MODULE] PROGMEM = {
+  DrawCharKernel<0>, DrawCharKernel<1>, DrawCharKernel<2>, DrawCharKernel<3>,
+  DrawCharKernel<4>, DrawCharKernel<5>, DrawCharKernel<6>, DrawCharKernel<7>};
+
+// Sprite blitters for unflipped spans: one per vertical offset
+typedef void (*SPRITE_KERNEL)(SPRITE_SPAN *p, byte *d);
+
+template <byte YOFF>
+static void BlitSpan(SPRITE_SPAN *p, byte *d) {
+  byte k, mask, cNew, bLoK = p->bLoK, bHiK = p->bHiK;
+
+  for (k = 0; k < p->bWidth; k++) {
+    if (YOFF == 0) { // the top row lines up with the page, never missing
+      mask = pgm_read_byte(p->sHiM + k);
+      cNew = pgm_read_byte(p->sHiP + k);
+    } else {
+      mask = FunnelShift(pgm_read_byte(p->sLoM + (k & bLoK)),
+                         pgm_read_byte(p->sHiM + (k & bHiK)), 8 - YOFF);
+      cNew = FunnelShift(pgm_read_byte(p->sLoP + (k & bLoK)),
+                         pgm_read_byte(p->sHiP + (k & bHiK)), 8 - YOFF);
+    }
+    d[k] = (d[k] & mask) | cNew;
+  }
+}
+
+const SPRITE_KERNEL pSpriteKernels[MODULE] PROGMEM = {
+  BlitSpan<0>, BlitSpan<1>, BlitSpan<2>, BlitSpan<3>,
+  BlitSpan<4>, BlitSpan<5>, BlitSpan<6>, BlitSpan<7>};
+#endif
+
 // Draw the sprites visible on the current line
 void DrawSprites(byte y, byte *pBuf, GFX_OBJECT *pList, byte bCount) {
-  byte i, x, bSize, bSprite, *s, *d;
-  byte cOld, cNew, mask, bYOff, bWidth;
+  SPRITE_SPAN span;
+  byte i, k, bLoK, bHiK, cNew, *d;
+#ifndef SPECIALIZED_KERNELS
+  byte cOld, mask;
+#endif
 
-  GFX_OBJECT *pObject;
   for (i = 0; i < bCount; i++) {
-    pObject = &pList[i];
-    bSprite = pObject->bType;          // index
-    bSize = (bSprite & 0x80) ? 16 : 8; // big or small sprite
-    // see if it's visible
-    if (pObject->y >= y + 8) // past bottom
+    if (!SpriteSpan(&pList[i], y, &span)) // not visible on this line
       continue;
-    if (pObject->y + bSize <= y) // above top
+    d = &pBuf[span.x]; // destination pointer
+    if (span.bFlags & (SPRITE_FLIP_H | SPRITE_FLIP_V)) {
+      for (k = 0; k < span.bWidth; k++)
+        d[k] = SpanBlend(&span, k, d[k]);
       continue;
-    if (pObject->x >= 128) // off right edge
+    }
+    if (span.bFlags & (SPRITE_OPAQUE | SPRITE_XOR)) { // pattern only
+      if (span.bYOff == 0 && !(span.bFlags & SPRITE_XOR)) {
+        memcpy_P(d, span.sHiP, span.bWidth);
+        continue;
+      }
+      bLoK = span.bLoK;
+      bHiK = span.bHiK;
+      for (k = 0; k < span.bWidth; k++) {
+        cNew = pgm_read_byte(span.sHiP + (k & bHiK));
+        if (span.bYOff)
+          cNew = FunnelShift(pgm_read_byte(span.sLoP + (k & bLoK)), cNew, 8 - span.bYOff);
+        if (span.bFlags & SPRITE_XOR)
+          d[k] ^= cNew;
+        else
+          d[k] = (d[k] & span.bKeep) | cNew;
+      }
       continue;
-    // It's visible on this line; draw it
-    bSprite &= 0x7f;       // sprite index
-    d = &pBuf[pObject->x]; // destination pointer
-    if (bSize == 16) {
-      s = (byte *)&ucBigSprites[bSprite * 64];
-      if (pObject->y + 8 <= y) // special case - only bottom half drawn
-        s += 16;
-      bYOff = pObject->y & 7;
-      bWidth = 16;
-      if (128 - pObject->x < 16)
-        bWidth = 128 - pObject->x;
-      // 4 possible cases:
-      // byte aligned - single source, not shifted
-      // single source (shifted, top or bottom row)
-      // double source (middle) both need shifting
-      if (bYOff == 0) // simplest case
-      {
-        for (x = 0; x < bWidth; x++) {
-          cOld = d[0];
-          mask = pgm_read_byte(s);
-          cNew = pgm_read_byte(s + 32);
-          s++;
-          cOld &= mask;
-          cOld |= cNew;
-          *d++ = cOld;
-        }
-      } else if (pObject->y + 8 < y) // only bottom half of sprite drawn
-      {
-        for (x = 0; x < bWidth; x++) {
-          mask = pgm_read_byte(s);
-          cNew = pgm_read_byte(s + 32);
-          s++;
-          mask >>= (8 - bYOff);
-          mask |= (0xff << bYOff);
-          cNew >>= (8 - bYOff);
-          cOld = d[0];
-          cOld &= mask;
-          cOld |= cNew;
-          *d++ = cOld;
-        }                        // for x
-      } else if (pObject->y > y) // only top half of sprite drawn
-      {
-        for (x = 0; x < bWidth; x++) {
-          mask = pgm_read_byte(s);
-          cNew = pgm_read_byte(s + 32);
-          s++;
-          mask <<= bYOff;
-          mask |= (0xff >> (8 - bYOff)); // exposed bits set to 1
-          cNew <<= bYOff;
-          cOld = d[0];
-          cOld &= mask;
-          cOld |= cNew;
-          *d++ = cOld;
-        }    // for x
-      } else // most difficult - part of top and bottom drawn together
-      {
-        byte mask2, cNew2;
-        for (x = 0; x < bWidth; x++) {
-          mask = pgm_read_byte(s);
-          mask2 = pgm_read_byte(s + 16);
-          cNew = pgm_read_byte(s + 32);
-          cNew2 = pgm_read_byte(s + 48);
-          s++;
-          mask >>= (8 - bYOff);
-          cNew >>= (8 - bYOff);
-          mask2 <<= bYOff;
-          cNew2 <<= bYOff;
-          mask |= mask2; // combine top and bottom
-          cNew |= cNew2;
-          cOld = d[0];
-          cOld &= mask;
-          cOld |= cNew;
-          *d++ = cOld;
-        } // for x
+    }
+#ifdef SPECIALIZED_KERNELS
+    ((SPRITE_KERNEL)pgm_read_ptr(&pSpriteKernels[span.bYOff]))(&span, d);
+#else
+    if (span.bYOff == 0) { // byte aligned - single source, not shifted
+      for (k = 0; k < span.bWidth; k++) {
+        cOld = d[k];
+        mask = pgm_read_byte(span.sHiM + k);
+        cNew = pgm_read_byte(span.sHiP + k);
+        cOld &= mask;
+        cOld |= cNew;
+        d[k] = cOld;
       }
-    } else // 8x8 sprite
-    {
-      s = (byte *)&ucSprites[bSprite * 16];
-      bYOff = pObject->y & 7;
-      bWidth = 8;
-      if (128 - pObject->x < 8)
-        bWidth = 128 - pObject->x;
-      for (x = 0; x < bWidth; x++) {
-        mask = pgm_read_byte(s);
-        cNew = pgm_read_byte(s + 8);
-        s++;
-        if (bYOff) // needs to be shifted
-        {
-          if (pObject->y > y) {
-            mask <<= bYOff;
-            mask |= (0xff >> (8 - bYOff)); // exposed bits set to 1
-            cNew <<= bYOff;
-          } else {
-            mask >>= (8 - bYOff);
-            mask |= (0xff << bYOff);
-            cNew >>= (8 - bYOff);
-          }
-        } // needs to be shifted
-        cOld = d[0];
+    } else { // two source rows shifted together, a missing one reads blank
+      bLoK = span.bLoK;
+      bHiK = span.bHiK;
+      for (k = 0; k < span.bWidth; k++) {
+        mask = FunnelShift(pgm_read_byte(span.sLoM + (k & bLoK)),
+                           pgm_read_byte(span.sHiM + (k & bHiK)), 8 - span.bYOff);
+        cNew = FunnelShift(pgm_read_byte(span.sLoP + (k & bLoK)),
+                           pgm_read_byte(span.sHiP + (k & bHiK)), 8 - span.bYOff);
+        cOld = d[k];
         cOld &= mask;
         cOld |= cNew;
-        *d++ = cOld;
-      } // for x
+        d[k] = cOld;
+      }
     }
+#endif
   } // for each sprite
 }
 
-// Draw the playfield and sprites
-void DrawPlayfield(byte bScrollX, byte bScrollY) {
-  byte bTemp[SCREEN_WIDTH]; // holds data for the current scan line
-  byte x, y, tx;
-  int ty, bXOff, bYOff;
-  byte c, *s, *sNext, *d;
-  int iOffset, iOffset2, cIndex, cIndex2;
+// Sprites of each page, built once per frame: the object indices of page p
+// are bBucket[bPageStart[p]] .. bBucket[bPageStart[p + 1] - 1], sorted by x
+static byte bBucket[(MAX_SPRITE_PAGES + 1) * MAX_OBJECTS];
+static byte bPageStart[VIEWPORT_HEIGHT + 1];
+
+// Pages an object covers on the screen, false if it's off the screen
+static bool SpritePages(GFX_OBJECT *pObject, byte *pFirst, byte *pLast) {
+  int sx, sy, iLast;
+
+  sx = pObject->x - iViewX;
+  sy = pObject->y - iViewY;
+  if (sx >= SCREEN_WIDTH || sx + (int)pgm_read_byte(&spriteTable[pObject->bType].bWidth) <= 0)
+    return 0;
+  iLast = sy + pgm_read_byte(&spriteTable[pObject->bType].bPages) * 8 - 1;
+  if (sy >= SCREEN_HEIGHT || iLast < 0)
+    return 0;
+  if (sy < 0)
+    sy = 0;
+  if (iLast >= SCREEN_HEIGHT)
+    iLast = SCREEN_HEIGHT - 1;
+  *pFirst = sy >> 3;
+  *pLast = iLast >> 3;
+  return 1;
+}
 
-  // Solo es cero cuando el scroll completa un MODULO su eje X (8 unidades)
-  bXOff = bScrollX & (MODULE - 1);
-  bYOff = bScrollY & (MODULE - 1);
+void BucketSprites(GFX_OBJECT *pList, byte bCount) {
+  byte i, j, p, p0, p1, bIndex, bFill[VIEWPORT_HEIGHT];
+  GFX_OBJECT *pObject;
+
+  // count the entries of every page, then turn counts into start offsets
+  memset(bPageStart, 0, sizeof(bPageStart));
+  for (i = 0; i < bCount; i++) {
+    if (!SpritePages(&pList[i], &p0, &p1))
+      continue;
+    for (p = p0; p <= p1; p++)
+      bPageStart[p + 1]++;
+  }
+  for (p = 0; p < VIEWPORT_HEIGHT; p++) {
+    bPageStart[p + 1] += bPageStart[p];
+    bFill[p] = bPageStart[p];
+  }
+
+  // fill each page, keeping it sorted by x (insertion sort, pages are short)
+  for (i = 0; i < bCount; i++) {
+    pObject = &pList[i];
+    if (!SpritePages(pObject, &p0, &p1))
+      continue;
+    for (p = p0; p <= p1; p++) {
+      for (j = bFill[p]++; j > bPageStart[p]; j--) {
+        bIndex = bBucket[j - 1];
+        if (pList[bIndex].x <= pObject->x)
+          break;
+        bBucket[j] = bIndex;
+      }
+      bBucket[j] = i;
+    }
+  }
+}
+
+// Pages that can't draw all of their sprites take turns: SPRITE_BUDGET, and
+// OLED_STREAM which has room for STREAM_SPANS of them
+#if defined(SPRITE_BUDGET) || defined(OLED_STREAM)
+#define SPRITE_WINDOW
+static byte bPageRotate[VIEWPORT_HEIGHT]; // bucket entry each page starts with
+byte bSpritesDropped[VIEWPORT_HEIGHT]; // sprites left out per page, last frame
+unsigned int uiSpritesDropped; // counter for tuning
+#endif
+
+// Pick the bucket entries page bPage draws this frame, at most bMax of them:
+// returns how many, starting at entry *pStart and wrapping around the end of
+// the page. Called once per page and frame. At least one entry is drawn, so
+// a sprite wider than the whole budget can't stall its page: with k entries
+// on an overloaded page, each of them is drawn at least once every k frames.
+static byte PageSpriteWindow(byte bPage, byte *pStart, GFX_OBJECT *pList, byte bMax) {
+  byte n = bPageStart[bPage + 1] - bPageStart[bPage];
+#ifdef SPRITE_WINDOW
+  byte i, j;
+#ifdef SPRITE_BUDGET
+  byte *b = &bBucket[bPageStart[bPage]];
+  byte bCost = 0;
+#endif
+
+  j = bPageRotate[bPage];
+  if (j >= n)
+    j = 0;
+  *pStart = j;
+  for (i = 0; i < n && i < bMax; i++) {
+#ifdef SPRITE_BUDGET
+    bCost += (pgm_read_byte(&spriteTable[pList[b[j]].bType].bWidth) + 7) >> 3;
+    if (bCost > SPRITE_BUDGET && i) // the first goes even if it alone is over
+      break;
+#endif
+    if (++j == n)
+      j = 0;
+  }
+  bSpritesDropped[bPage] = n - i;
+  uiSpritesDropped += n - i;
+  bPageRotate[bPage] = (i < n) ? j : 0; // the first one left out leads next time
+  return i;
+#else
+  *pStart = 0;
+  return (n < bMax) ? n : bMax;
+#endif
+}
+
+// Draw the sprites bucketed on page bPage
+void DrawPageSprites(byte bPage, byte *pBuf, GFX_OBJECT *pList) {
+  byte i, j, n, bStart, *b = &bBucket[bPageStart[bPage]];
+
+  n = PageSpriteWindow(bPage, &bStart, pList, 0xff);
+  for (i = 0, j = bStart; i < n; i++) {
+    DrawSprites(bPage * MODULE, pBuf, &pList[b[j]], 1);
+    if (++j == bPageStart[bPage + 1] - bPageStart[bPage])
+      j = 0;
+  }
+}
+
+#ifdef OLED_HW_SCROLL
+// Hardware scroll state: what the GDDRAM ring currently holds
+static bool bHwValid = 0; // false forces a full redraw
+static unsigned int uiHwScrollX, uiHwRow;
+static byte bHwYOff;
+
+// Draw one unshifted row of tiles, replacing only the bits set in bMask
+static void DrawTileRow(byte *d, unsigned int uiRow, unsigned int uiScrollX, byte bMask) {
+  byte x, tx, bXOff, c, *s, *row, *end = d + SCREEN_WIDTH;
 
-    // Incrementa una unidad cada vez que el scroll completa un MODULO en Y
-  ty = (bScrollY >> 3) + (EDGES / 2);
+  row = &bPlayfield[(uiRow % PLAYFIELD_ROWS) * PLAYFIELD_COLS];
+  bXOff = uiScrollX & (MODULE - 1);
+  tx = ((uiScrollX >> 3) + (EDGES / 2)) % PLAYFIELD_COLS;
+
+  // 17 characters when bXOff leaves a partial one on each edge
+  for (x = 0; x <= VIEWPORT_WIDTH && d != end; x++) {
+    if (tx >= PLAYFIELD_COLS) {
+      tx -= PLAYFIELD_COLS;
+    }
+    s = (byte *)&ucTiles[(row[tx] * MODULE) + bXOff];
+    for (; bXOff < MODULE && d != end; bXOff++) {
+      c = pgm_read_byte(s++);
+      *d = (*d & ~bMask) | (c & bMask);
+      d++;
+    }
+    bXOff = 0;
+    tx++;
+  }
+}
+
+// Compose and send GDDRAM page (bRow & 7). With a vertical offset, the page
+// that holds the top row of the screen also holds the bottom partial row:
+// its bits below bYOff wrap around to the bottom of the display. Only
+// changed pages get here, so OLED_PAGE_SKIP's signatures are bypassed: an
+// idle hardware scroll sends nothing that could trigger PAGE_REFRESH.
+static void DrawHwScrollPage(unsigned int uiRow, unsigned int uiScrollX, byte bYOff) {
+#ifdef OLED_ASYNC
+  byte *bTemp = oledPageBuffer();
+#else
+  byte bTemp[SCREEN_WIDTH];
+#endif
+  byte bPage = uiRow & (VIEWPORT_HEIGHT - 1);
+
+  if (bYOff && bPage == (uiHwRow & (VIEWPORT_HEIGHT - 1))) {
+    DrawTileRow(bTemp, uiHwRow, uiScrollX, 0xff << bYOff);
+    DrawTileRow(bTemp, uiHwRow + VIEWPORT_HEIGHT, uiScrollX, ~(0xff << bYOff));
+  } else {
+    DrawTileRow(bTemp, uiRow, uiScrollX, 0xff);
+  }
+
+  oledWritePage(bPage, bTemp);
+}
+
+// Vertical scroll using the display start line (0x40 | n) as the ring
+// buffer offset. Only the page at the top/bottom seam changes on a 1px step;
+// crossing a tile boundary also restores the previous seam page. The display
+// offset (0xD3) stays at 0, with a 64 row MUX the start line alone rotates
+// the whole GDDRAM.
+static void DrawPlayfieldHwScroll(unsigned int uiScrollX, unsigned int uiScrollY) {
+  byte y, bOldYOff, bOldValid = bHwValid;
+  unsigned int uiOldRow;
+  unsigned int uiRow = (uiScrollY >> 3) + (EDGES / 2); // row at the top of the screen
+  byte bYOff = uiScrollY & (MODULE - 1);
+  int iDelta = uiRow - uiHwRow;
 
   adjustPlayField();
 
-  // -------------------------------------------------------
+  uiOldRow = uiHwRow;
+  bOldYOff = bHwYOff;
+  uiHwRow = uiRow;
+  bHwYOff = bYOff;
 
-  // draw the 8 rows
-  for (y = 0; y < VIEWPORT_HEIGHT; y++) {
-    memset(bTemp, 0, sizeof(bTemp));
+  if (!bHwValid || uiScrollX != uiHwScrollX || iDelta > 1 || iDelta < -1) {
+    // everything changed, refill the ring with the visible rows
+    for (y = 0; y < VIEWPORT_HEIGHT; y++) {
+      DrawHwScrollPage(uiRow + y, uiScrollX, bYOff);
+    }
+    uiHwScrollX = uiScrollX;
+    bHwValid = 1;
+  } else if (iDelta) {
+    // tile boundary crossed: the old seam page becomes a plain row again
+    DrawHwScrollPage(iDelta > 0 ? uiOldRow + VIEWPORT_HEIGHT : uiOldRow, uiScrollX, bYOff);
+    DrawHwScrollPage(uiRow, uiScrollX, bYOff);
+  } else if (bYOff != bOldYOff) {
+    DrawHwScrollPage(uiRow, uiScrollX, bYOff);
+  }
+
+  if (!bOldValid || uiRow != uiOldRow || bYOff != bOldYOff) {
+    oledWriteCommand(0x40 | ((uiScrollY + (EDGES / 2) * MODULE) & (SCREEN_HEIGHT - 1)));
+  }
+}
+#endif
+
+#ifdef OLED_STREAM
+// Sprites composed per page, their spans (16 bytes each) live on the stack.
+// A page with more takes turns through PageSpriteWindow(), with or without
+// SPRITE_BUDGET.
+#ifdef SPRITE_BUDGET
+#define STREAM_CAP SPRITE_BUDGET // every sprite costs at least 1
+#else
+#define STREAM_CAP 4
+#endif
+#define STREAM_SPANS (MAX_OBJECTS < STREAM_CAP ? MAX_OBJECTS : STREAM_CAP)
+
+// Compose each column byte from the tiles and sprites and send it right away
+static void DrawPlayfieldStream(unsigned int uiScrollX, unsigned int uiScrollY) {
+  SPRITE_SPAN spans[STREAM_SPANS], *p;
+  GFX_OBJECT *pObject;
+  byte x, y, i, k, tx, ty, col, bXOff, bYOff, bSpans, bDraw, bEntry;
+  byte c, *row, *rowNext, *s, *sNext;
 
+  bXOff = uiScrollX & (MODULE - 1);
+  bYOff = uiScrollY & (MODULE - 1);
+  ty = ((uiScrollY >> 3) + (EDGES / 2)) % PLAYFIELD_ROWS;
+
+  adjustPlayField();
+  BucketSprites(object_list, bObjects);
+
+#ifdef OLED_FRAME_PUSH
+  // the whole frame is one data transaction
+  oledSetWindow(0, SCREEN_WIDTH - 1, 0, VIEWPORT_HEIGHT - 1);
+  i2cBegin(SSD1306_SA);
+  i2cByteOut(0x40);
+#endif
+  for (y = 0; y < VIEWPORT_HEIGHT; y++) {
     if (ty >= PLAYFIELD_ROWS) {
       ty -= PLAYFIELD_ROWS;
     }
+    row = &bPlayfield[ty * PLAYFIELD_COLS];
+    rowNext = (ty + 1 < PLAYFIELD_ROWS) ? row + PLAYFIELD_COLS : bPlayfield;
+
+    // sprites on this page
+    bSpans = 0;
+    bDraw = PageSpriteWindow(y, &bEntry, object_list, STREAM_SPANS);
+    for (i = 0; i < bDraw; i++) {
+      pObject = &object_list[bBucket[bPageStart[y] + bEntry]];
+      if (++bEntry == bPageStart[y + 1] - bPageStart[y])
+        bEntry = 0;
+      if (SpriteSpan(pObject, y * MODULE, &spans[bSpans]))
+        bSpans++;
+    }
 
-    tx = (bScrollX >> 3) + (EDGES / 2);
+#ifndef OLED_FRAME_PUSH
+    oledSetPosition(0, y);
+    i2cBegin(SSD1306_SA);
+    i2cByteOut(0x40);
+#endif
+    tx = ((uiScrollX >> 3) + (EDGES / 2)) % PLAYFIELD_COLS;
+    col = bXOff;
+    s = (byte *)&ucTiles[row[tx] * MODULE];
+    sNext = (byte *)&ucTiles[rowNext[tx] * MODULE];
+    for (x = 0; x < SCREEN_WIDTH; x++) {
+      c = pgm_read_byte(s + col);
+      if (bYOff) {
+        c = FunnelShift(c, pgm_read_byte(sNext + col), bYOff);
+      }
+      for (i = 0; i < bSpans; i++) {
+        p = &spans[i];
+        k = x - p->x;
+        if (k >= p->bWidth)
+          continue;
+        c = SpanBlend(p, k, c);
+      }
+      i2cByteOut(c);
+      if (++col == MODULE) { // next tile
+        col = 0;
+        if (++tx == PLAYFIELD_COLS) {
+          tx = 0;
+        }
+        s = (byte *)&ucTiles[row[tx] * MODULE];
+        sNext = (byte *)&ucTiles[rowNext[tx] * MODULE];
+      }
+    }
+#ifndef OLED_FRAME_PUSH
+    i2cEnd();
+#endif
+    ty++;
+  }
+#ifdef OLED_FRAME_PUSH
+  i2cEnd();
+#endif
+}
+#endif
 
-    // Draw the playfield characters at the given scroll position
-    d = bTemp;
+// Draw the playfield and sprites
+void DrawPlayfield(unsigned int uiScrollX, unsigned int uiScrollY) {
+#ifdef OLED_ASYNC
+  byte *bTemp; // from oledPageBuffer(), the other one may still be on the wire
+#else
+  byte bTemp[SCREEN_WIDTH]; // holds data for the current scan line
+#endif
+  byte y, tx, ty, bXOff, bYOff, bWidth;
+  byte *s, *sNext, *d, *row, *rowNext, *pTile, *pTileNext;
+#ifdef SPECIALIZED_KERNELS
+  CHAR_KERNEL pfnChar;
+#endif
 
-    // partial characters vertically means a lot more work :(
-    // Only for vertical scroll:
-    if (bYOff) {
-      for (x = 0; x < VIEWPORT_WIDTH; x++) {
-        if (tx >= PLAYFIELD_COLS) {
-          tx -= PLAYFIELD_COLS; // wrap around
-        }
+  iViewX = uiScrollX + (EDGES / 2) * MODULE;
+  iViewY = uiScrollY + (EDGES / 2) * MODULE;
+#ifdef OLED_HW_SCROLL
+  DrawPlayfieldHwScroll(uiScrollX, uiScrollY); // tiles only, no sprites
+  return;
+#endif
+#ifdef OLED_STREAM
+  DrawPlayfieldStream(uiScrollX, uiScrollY);
+  return;
+#endif
 
-        iOffset = (tx + ty * PLAYFIELD_COLS);
-        iOffset2 = (iOffset + PLAYFIELD_COLS); // next line
+  // Solo es cero cuando el scroll completa un MODULO su eje X (8 unidades)
+  bXOff = uiScrollX & (MODULE - 1);
+  bYOff = uiScrollY & (MODULE - 1);
+#ifdef SPECIALIZED_KERNELS
+  pfnChar = (CHAR_KERNEL)pgm_read_ptr(&pCharKernels[bYOff]);
+#endif
 
-        if (iOffset2 >= (PLAYFIELD_ROWS * PLAYFIELD_COLS)) {    // past bottom
-          iOffset2 -= (PLAYFIELD_ROWS * PLAYFIELD_COLS);
-        }
+  // Ring buffer row and column of the top left tile, the only divisions of
+  // the frame; everything below walks pointers and wraps them by compare
+  ty = ((uiScrollY >> 3) + (EDGES / 2)) % PLAYFIELD_ROWS;
+  tx = ((uiScrollX >> 3) + (EDGES / 2)) % PLAYFIELD_COLS;
 
-        cIndex = iOffset % (PLAYFIELD_ROWS * PLAYFIELD_COLS);
-        c = bPlayfield[cIndex];
-        s = (byte *)&ucTiles[(c * MODULE) + bXOff];
+  adjustPlayField();
+  BucketSprites(object_list, bObjects);
 
-        cIndex2 = iOffset2 % (PLAYFIELD_ROWS * PLAYFIELD_COLS);
-        c = bPlayfield[cIndex2];
-        sNext = (byte *)&ucTiles[(c * MODULE) + bXOff];
-        // ------------------------------------------------------------------------------
+  // -------------------------------------------------------
 
-        DrawShiftedChar(s, sNext, d, bXOff, bYOff);
+  // draw the 8 rows
+  row = &bPlayfield[ty * PLAYFIELD_COLS];
+  for (y = 0; y < VIEWPORT_HEIGHT; y++) {
+#ifdef OLED_ASYNC
+    bTemp = oledPageBuffer();
+#endif
+    rowNext = row + PLAYFIELD_COLS; // next line, for partial characters
+    if (rowNext == &bPlayfield[PLAYFIELD_ROWS * PLAYFIELD_COLS]) {
+      rowNext = bPlayfield;
+    }
+    pTile = row + tx;
+    pTileNext = rowNext + tx;
 
-        d += (MODULE - bXOff);
-        bXOff = 0;
-        tx++;
+    // Draw the playfield characters at the given scroll position: the first
+    // one starts bXOff columns in, the last one is cut at the right edge
+    d = bTemp;
+    bWidth = MODULE - bXOff;
+    s = (byte *)&ucTiles[*pTile * MODULE + bXOff];
+    sNext = (byte *)&ucTiles[*pTileNext * MODULE + bXOff];
+    while (1) {
+      // partial characters vertically means a lot more work :(
+      if (bYOff) {
+#ifdef SPECIALIZED_KERNELS
+        (*pfnChar)(s, sNext, d, MODULE - bWidth);
+#else
+        DrawShiftedChar(s, sNext, d, MODULE - bWidth, bYOff);
+#endif
+      } else {
+        memcpy_P(d, s, bWidth);
       }
-
-      // partial character left to draw
-      if (d != &bTemp[SCREEN_WIDTH]) {
-        bXOff = (byte)(&bTemp[SCREEN_WIDTH] - d);
-        if (tx >= PLAYFIELD_COLS)
-          tx -= PLAYFIELD_COLS;
-        iOffset = tx + ty * PLAYFIELD_COLS;
-        iOffset2 = iOffset + PLAYFIELD_COLS; // next line
-        if (iOffset2 >= (PLAYFIELD_ROWS * PLAYFIELD_COLS))     // past bottom
-          iOffset2 -= (PLAYFIELD_ROWS * PLAYFIELD_COLS);
-        c = bPlayfield[iOffset];
-        s = (byte *)&ucTiles[c * MODULE];
-        c = bPlayfield[iOffset2];
-        sNext = (byte *)&ucTiles[c * MODULE];
-        DrawShiftedChar(s, sNext, d, MODULE - bXOff, bYOff);
+      d += bWidth;
+      if (d == &bTemp[SCREEN_WIDTH]) {
+        break;
       }
-    // simpler case of vertical offset of 0 for each character
-    } else {
-      //-----------------------------------
-      // NON BYOFF; SCREEN BYTE COMPLETED!
-      //-----------------------------------
-
-      // Filling each col of the SCREEN_WIDTH
-      for (x = 0; x < VIEWPORT_WIDTH; x++) {
-        if (tx >= PLAYFIELD_COLS) {
-          tx -= PLAYFIELD_COLS;
-        }
 
-        iOffset = tx + (ty * PLAYFIELD_COLS);
-        cIndex = iOffset % (PLAYFIELD_ROWS * PLAYFIELD_COLS);
-        c = bPlayfield[cIndex];
-        s = (byte *)&ucTiles[(c * MODULE) + bXOff];
-        memcpy_P(d, s, MODULE - bXOff);
-        d += (MODULE - bXOff);
-        bXOff = 0;
-        tx++;
+      if (++pTile == row + PLAYFIELD_COLS) { // wrap around
+        pTile = row;
+        pTileNext = rowNext;
+      } else {
+        pTileNext++;
       }
-
-      // partial character left to draw
-      // De momento el codigo no pasa por aqui.
-      if (d != &bTemp[SCREEN_WIDTH]) {
-        bXOff = (byte)(&bTemp[SCREEN_WIDTH] - d);
-        if (tx >= PLAYFIELD_COLS) {
-          tx -= PLAYFIELD_COLS;
-        }
-        iOffset = tx + ty * PLAYFIELD_COLS;
-        c = bPlayfield[iOffset];
-        s = (byte *)&ucTiles[c * MODULE];
-        memcpy_P(d, s, bXOff);
+      s = (byte *)&ucTiles[*pTile * MODULE];
+      sNext = (byte *)&ucTiles[*pTileNext * MODULE];
+      bWidth = &bTemp[SCREEN_WIDTH] - d;
+      if (bWidth > MODULE) {
+        bWidth = MODULE;
       }
     }
 
-    //DrawSprites(y * VIEWPORT_HEIGHT, bTemp, object_list, numberOfSprites);
+    DrawPageSprites(y, bTemp, object_list);
     // Send it to the display
-    oledSetPosition(0, y);
-    I2CWriteData(bTemp, SCREEN_WIDTH);
-    ty++;
+    oledSendPage(y, bTemp);
+    row = rowNext;
   }
 }
 
@@ -675,11 +1546,283 @@ void moveBackground() {
     }
 }
 
+#ifdef I2C_USI
+// Pin change interrupt, PCINT3, PB3, pin2
+ISR(PCINT0_vect) {
+  moveBackground();
+}
+#endif
+
+#ifdef BENCHMARK
+// Benchmarks **********************************************
+// Cycle counts come from benchClock(). micros() only has 8us resolution at
+// 8MHz, so every block is repeated BENCH_REPEAT times, under simavr once is
+// exact. One "name,cycles per unit" line per result.
+#ifdef BENCHMARK_SIMAVR
+#define BENCH_REPEAT 1
+#else
+#define BENCH_REPEAT 8
+#endif
+
+static void benchReport(const __FlashStringHelper *name, unsigned long cycles, unsigned int units) {
+  Serial.print(name);
+  Serial.print(',');
+  Serial.println(cycles / units);
+}
+
+// I2C transport: cycles per data byte for blank (0x00, the bit-bang fast
+// path) and patterned pages, and cycles per oledSetPosition call
+static void benchI2C() {
+  byte bTemp[SCREEN_WIDTH];
+  unsigned long t;
+  byte i;
+
+#ifdef I2C_USI
+  Serial.println(F("i2c_transport,usi"));
+#else
+  Serial.println(F("i2c_transport,bitbang"));
+#endif
+
+  memset(bTemp, 0, sizeof(bTemp));
+  t = benchClock();
+  for (i = 0; i < BENCH_REPEAT; i++) {
+    I2CWriteData(bTemp, SCREEN_WIDTH);
+  }
+  benchReport(F("i2c_byte_blank"), benchClock() - t, BENCH_REPEAT * SCREEN_WIDTH);
+
+  memset(bTemp, 0x5a, sizeof(bTemp));
+  t = benchClock();
+  for (i = 0; i < BENCH_REPEAT; i++) {
+    I2CWriteData(bTemp, SCREEN_WIDTH);
+  }
+  benchReport(F("i2c_byte_pattern"), benchClock() - t, BENCH_REPEAT * SCREEN_WIDTH);
+
+  t = benchClock();
+  for (i = 0; i < BENCH_REPEAT; i++) {
+    oledSetPosition(0, i);
+  }
+  benchReport(F("i2c_set_position"), benchClock() - t, BENCH_REPEAT);
+
+#ifdef OLED_PAGE_SKIP
+  oledInvalidatePages();
+#endif
+}
+
+// Vertically shifted tile kernel: cycles per DrawShiftedChar call (one full
+// 8 column tile, the specialized kernel when enabled) for each bYOff
+static void benchShift() {
+  byte bTemp[MODULE];
+  byte *s1 = (byte *)&ucTiles[0], *s2 = (byte *)&ucTiles[MODULE];
+  unsigned long t;
+  byte i, bYOff;
+
+  for (bYOff = 1; bYOff < MODULE; bYOff++) {
+    t = benchClock();
+    for (i = 0; i < BENCH_REPEAT * 4; i++) {
+#ifdef SPECIALIZED_KERNELS
+      (*(CHAR_KERNEL)pgm_read_ptr(&pCharKernels[bYOff]))(s1, s2, bTemp, 0);
+#else
+      DrawShiftedChar(s1, s2, bTemp, 0, bYOff);
+#endif
+    }
+    t = benchClock() - t;
+    Serial.print(F("shifted_char_yoff_"));
+    Serial.print((char)('0' + bYOff));
+    Serial.print(',');
+    Serial.println(t / (BENCH_REPEAT * 4));
+  }
+}
+
+// Frame time of DrawPlayfield along a diagonal scroll, including the time
+// until the last page has left so sync and async builds do the same work
+static void benchFrame() {
+  unsigned long t;
+  byte i;
+
+#ifdef OLED_ASYNC
+  Serial.println(F("frame_transmit,async"));
+  ulAsyncWait = 0;
+#else
+  Serial.println(F("frame_transmit,sync"));
+#endif
+  t = benchClock();
+  for (i = 0; i < BENCH_REPEAT; i++) {
+    iScrollX = iScrollY = i;
+    DrawPlayfield(iScrollX, iScrollY);
+  }
+#ifdef OLED_ASYNC
+  oledWaitIdle();
+#endif
+  benchReport(F("frame_draw"), benchClock() - t, BENCH_REPEAT);
+#ifdef OLED_ASYNC
+  benchReport(F("frame_async_wait"), ulAsyncWait, BENCH_REPEAT);
+#endif
+
+  // idle frames: same scroll position every time
+#ifdef OLED_PAGE_SKIP
+  uiPagesSent = uiPagesSkipped = 0;
+#endif
+  t = benchClock();
+  for (i = 0; i < BENCH_REPEAT; i++) {
+    DrawPlayfield(iScrollX, iScrollY);
+  }
+#ifdef OLED_ASYNC
+  oledWaitIdle();
+#endif
+  benchReport(F("frame_idle"), benchClock() - t, BENCH_REPEAT);
+#ifdef OLED_PAGE_SKIP
+  Serial.print(F("pages_sent,"));
+  Serial.println(uiPagesSent);
+  Serial.print(F("pages_skipped,"));
+  Serial.println(uiPagesSkipped);
+#endif
+
+  iScrollX = iScrollY = 0;
+  reloadPlayField();
+}
+
+// Frame cost at each of the 64 sub-tile scroll positions, one frame each,
+// then the rate at which adjustPlayField streams map rows while scrolling
+static void benchScroll() {
+  unsigned long t;
+  byte x, y;
+
+  for (y = 0; y < MODULE; y++) {
+    for (x = 0; x < MODULE; x++) {
+      iScrollX = x;
+      iScrollY = y;
+      t = benchClock();
+      DrawPlayfield(iScrollX, iScrollY);
+#ifdef OLED_ASYNC
+      oledWaitIdle();
+#endif
+      t = benchClock() - t;
+      Serial.print(F("frame_scroll_"));
+      Serial.print((char)('0' + x));
+      Serial.print('_');
+      Serial.print((char)('0' + y));
+      Serial.print(',');
+      Serial.println(t);
+    }
+  }
+
+  // vertical scroll over 8 tile rows: map rows streamed per second
+  iScrollX = iScrollY = 0;
+  reloadPlayField();
+  uiRowsStreamed = 0;
+  t = benchClock();
+  for (y = 0; y < SCREEN_HEIGHT; y++) {
+    iScrollY = y;
+    DrawPlayfield(iScrollX, iScrollY);
+  }
+#ifdef OLED_ASYNC
+  oledWaitIdle();
+#endif
+  t = benchClock() - t;
+  Serial.print(F("rows_streamed_per_sec,"));
+  Serial.println(uiRowsStreamed * (F_CPU / 1000) / (t / 1000));
+
+  // adjustPlayField alone, one tile step each way: a column, then a row
+  iScrollX = iScrollY = 0;
+  reloadPlayField();
+  iScrollX = MODULE;
+  t = benchClock();
+  adjustPlayField();
+  benchReport(F("adjust_playfield_col"), benchClock() - t, 1);
+  iScrollY = MODULE;
+  t = benchClock();
+  adjustPlayField();
+  benchReport(F("adjust_playfield_row"), benchClock() - t, 1);
+
+  iScrollX = iScrollY = 0;
+  reloadPlayField();
+}
+
+// Sprite cost of a frame (all 8 pages, no playfield): every object checked
+// on every page against the bucket pass, for 1, 8, 16 and 32 objects. Counts
+// above MAX_OBJECTS are skipped. The ATtiny85 runs 1 and 8 (env:simbench):
+// each object takes 9 bytes of RAM, and 16 of them leave too little for the
+// stack. 16 and 32 are for the native build (-D MAX_OBJECTS=32).
+static void benchSprites() {
+  static const byte bCounts[] = {1, 8, 16, 32};
+  byte *bTemp = bPlayfield; // 180 bytes the sweep doesn't need, the stack has no room for a page
+  GFX_OBJECT first = object_list[0];
+  byte bSaved = bObjects;
+  unsigned long t;
+  byte i, n, p;
+
+  for (i = 0; i < sizeof(bCounts); i++) {
+    n = bCounts[i];
+    if (n > MAX_OBJECTS)
+      break;
+    iViewX = iViewY = 0; // object coordinates are screen coordinates
+    for (p = 0; p < n; p++) { // spread over the screen, both sizes
+      object_list[p].bType = (p & 1) ? SPRITE_MARIO : SPRITE_PHANTOM;
+      object_list[p].x = (p * 37) & 127;
+      object_list[p].y = (p * 23) & 63;
+    }
+
+    t = benchClock();
+    for (p = 0; p < VIEWPORT_HEIGHT * BENCH_REPEAT; p++) {
+      DrawSprites((p & (VIEWPORT_HEIGHT - 1)) * MODULE, bTemp, object_list, n);
+    }
+    t = benchClock() - t;
+    Serial.print(F("sprites_scan_"));
+    Serial.print(n);
+    Serial.print(',');
+    Serial.println(t / BENCH_REPEAT);
+
+#ifdef SPRITE_BUDGET
+    uiSpritesDropped = 0;
+#endif
+    t = benchClock();
+    for (p = 0; p < VIEWPORT_HEIGHT * BENCH_REPEAT; p++) {
+      if (!(p & (VIEWPORT_HEIGHT - 1)))
+        BucketSprites(object_list, n);
+      DrawPageSprites(p & (VIEWPORT_HEIGHT - 1), bTemp, object_list);
+    }
+    t = benchClock() - t;
+    Serial.print(F("sprites_bucket_"));
+    Serial.print(n);
+    Serial.print(',');
+    Serial.println(t / BENCH_REPEAT);
+#ifdef SPRITE_BUDGET
+    Serial.print(F("sprites_dropped_"));
+    Serial.print(n);
+    Serial.print(',');
+    Serial.println(uiSpritesDropped / BENCH_REPEAT); // per frame
+#endif
+  }
+
+  memset(object_list, 0, sizeof(object_list));
+  object_list[0] = first;
+  bObjects = bSaved;
+  reloadPlayField();
+}
+
+void benchmark() {
+  initTXPin();
+  benchI2C();
+  benchShift();
+  benchFrame();
+  benchScroll();
+  benchSprites();
+}
+#endif
+
 void setup() {
   delay(50); // wait for the OLED to fully power up
   oledInit(0, 0);
+#ifdef OLED_ASYNC
+  oledAsyncInit();
+#endif
 
+#ifdef I2C_USI
+  GIMSK |= (1 << PCIE);
+  PCMSK |= (1 << EncoderA);
+#else
   attachInterrupt(0, moveBackground, CHANGE); //INT0, PB2, pin7
+#endif
 
   iScrollX = 0;
   iScrollY = 0;
@@ -688,79 +1831,207 @@ void setup() {
 
   memset(object_list, 0, sizeof(object_list));
 
-  object_list[0].bType = 0x80; // big sprite
-  object_list[0].x = 14;
-  object_list[0].y = 40;
+  object_list[0].bType = SPRITE_MARIO;
+  object_list[0].x = (EDGES / 2) * MODULE + 14; // where loop() keeps him
+  object_list[0].y = (EDGES / 2) * MODULE + 40;
+  bObjects = 1;
+
+#ifdef BENCHMARK
+  benchmark();
+#ifdef BENCHMARK_SIMAVR
+  // simavr ends the run on a sleep with interrupts off
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  cli();
+  sleep_cpu();
+#endif
+#endif
+}
+
+// One frame of the game: draw, then act on what the encoder did
+void gameLoop() {
+  static int speed = 0;
+  int x, y;
+
+  // The world wraps around at the map edges, adjustPlayField() streams the
+  // jump in like any other. DrawPlayfield() takes the scroll unsigned, so it
+  // must be in [0, period) every frame: 65536 isn't a multiple of the map.
+  // The encoder moves it from an interrupt, hence the copy with them off.
+  cli();
+  if (iScrollX >= TILEMAP_WIDTH * MODULE) {
+    iScrollX -= TILEMAP_WIDTH * MODULE;
+  } else if (iScrollX < 0) {
+    iScrollX += TILEMAP_WIDTH * MODULE;
+  }
+  if (iScrollY >= TILEMAP_HEIGHT * MODULE) {
+    iScrollY -= TILEMAP_HEIGHT * MODULE;
+  } else if (iScrollY < 0) {
+    iScrollY += TILEMAP_HEIGHT * MODULE;
+  }
+  x = iScrollX;
+  y = iScrollY;
+  sei();
+
+  // Mario stays put on the screen while the world scrolls
+  object_list[0].x = x + (EDGES / 2) * MODULE + 14;
+  object_list[0].y = y + (EDGES / 2) * MODULE + 40;
+  DrawPlayfield(x, y);
+
+  // Desde aquí se puede definir la velocidad a la que responde el juego:
+  // Estaría bien sacar el valor a una variable:
+  // (++speed % 3) => Modulo 3 (33% speed)
+  // (++speed & 3) => Modulo 4 (25% speed)
+  if ((++speed % 3) == 0) { // Modulo 3 (33% speed)
+    if (analogRead(EncoderClick) < 940) {
+      backgroundDirection = !backgroundDirection;
+    }
+  }
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
-  int speed = 0;
-
   while (1) {
-    DrawPlayfield(iScrollX, iScrollY);
+    gameLoop();
+  }
+}
 
-    // Desde aquí se puede definir la velocidad a la que responde el juego:
-    // Estaría bien sacar el valor a una variable:
-    // (++speed % 3) => Modulo 3 (33% speed)
-    // (++speed & 3) => Modulo 4 (25% speed)
-    if ((++speed % 3) == 0) { // Modulo 3 (33% speed)
-      if (iScrollX >= PLAYFIELD_COLS * MODULE) {
-          iScrollX = 0;
-          reloadPlayField();
-      } else if (iScrollX < 0) {
-          iScrollX = (PLAYFIELD_COLS * MODULE) - 1;
-          reloadPlayField();
-      }
+// Read bLen tiles of map row my from column mx on; the span must not cross
+// the right edge of the map
+static void mapRowSpan(unsigned int my, unsigned int mx, byte *d, byte bLen) {
+#ifdef MAP_RLE
+  const byte *s = &ucMapRLE[pgm_read_word(&uiMapRLERows[my])];
+  byte bRun, bTile;
+
+  // skip the runs left of mx
+  while (mx >= (bRun = pgm_read_byte(s))) {
+    mx -= bRun;
+    s += 2;
+  }
+  bRun -= mx;
+  bTile = pgm_read_byte(s + 1);
+  while (1) {
+    if (bRun > bLen)
+      bRun = bLen;
+    memset(d, bTile, bRun);
+    d += bRun;
+    bLen -= bRun;
+    if (!bLen)
+      break;
+    s += 2;
+    bRun = pgm_read_byte(s);
+    bTile = pgm_read_byte(s + 1);
+  }
+#elif defined(MAP_METATILES)
+  const byte *m = &ucMetaMap[my >> 1][mx >> 1], *t;
+
+  // one metatile read covers two tiles of the row
+  for (; bLen; m++) {
+    t = &ucMetatiles[pgm_read_byte(m)][(my & 1) << 1];
+    if (!(mx & 1)) {
+      *d++ = pgm_read_byte(t);
+      mx++;
+      if (!--bLen)
+        break;
+    }
+    *d++ = pgm_read_byte(t + 1);
+    mx++;
+    bLen--;
+  }
+#else
+  memcpy_P(d, &tileMap[my][mx], bLen);
+#endif
+}
 
-      if (iScrollY >= 240) {
-        iScrollY = 8;
-        reloadPlayField();
-      } else if (iScrollY < 0) {
-        iScrollY = 232;
-        reloadPlayField();
-      }
+// Copy the held columns of one world row into bPlayfield: block flash
+// reads, split where the ring buffer or the map wraps around
+static void streamRow(unsigned int row) {
+  byte *d = &bPlayfield[(row % PLAYFIELD_ROWS) * PLAYFIELD_COLS];
+  unsigned int my = row % TILEMAP_HEIGHT;
+  byte x = uiColLeft % PLAYFIELD_COLS, bLeft = HELD_COLS, bLen;
+  unsigned int mx = uiColLeft % TILEMAP_WIDTH;
+
+  while (bLeft) {
+    bLen = bLeft;
+    if (bLen > PLAYFIELD_COLS - x)
+      bLen = PLAYFIELD_COLS - x;
+    if (bLen > TILEMAP_WIDTH - mx)
+      bLen = TILEMAP_WIDTH - mx;
+    mapRowSpan(my, mx, d + x, bLen);
+    bLeft -= bLen;
+    x += bLen;
+    if (x == PLAYFIELD_COLS)
+      x = 0;
+    mx += bLen;
+    if (mx == TILEMAP_WIDTH)
+      mx = 0;
+  }
+  uiRowsStreamed++;
+}
 
-      if (analogRead(EncoderClick) < 940) {
-        backgroundDirection = !backgroundDirection;
-      }
-    }
+// Copy the held rows of one world column into bPlayfield
+static void streamCol(unsigned int col) {
+  byte y, x = col % PLAYFIELD_COLS, ry = uiRowTop % PLAYFIELD_ROWS;
+  unsigned int mx = col % TILEMAP_WIDTH, my = uiRowTop % TILEMAP_HEIGHT;
+
+  for (y = 0; y < HELD_ROWS; y++) {
+    mapRowSpan(my, mx, &bPlayfield[ry * PLAYFIELD_COLS + x], 1);
+    if (++ry == PLAYFIELD_ROWS)
+      ry = 0;
+    if (++my == TILEMAP_HEIGHT)
+      my = 0;
   }
+  uiColsStreamed++;
 }
 
 void reloadPlayField() {
-  byte x, y, *d, bitStart,
-    iStart = iScrollY >> 3;
-
-  for (y = 0; y < PLAYFIELD_ROWS; y++) {
-    bitStart = ((iStart + y) * PLAYFIELD_COLS) % (PLAYFIELD_COLS * PLAYFIELD_ROWS);
-    d = &bPlayfield[bitStart];
+  byte y;
 
-    for (x = 0; x < PLAYFIELD_COLS; x++) {
-      memcpy_P(d++, &tileMap[(iStart + y) % TILEMAP_HEIGHT][x], 1);
-    }
+  uiRowTop = ((unsigned int)iScrollY >> 3) + (EDGES / 2);
+  uiColLeft = ((unsigned int)iScrollX >> 3) + (EDGES / 2);
+  for (y = 0; y < HELD_ROWS; y++) {
+    streamRow(uiRowTop + y);
   }
+  bPlayfieldValid = 1;
 }
 
+// Stream in the world rows and columns that entered the viewport since the
+// last call, nothing while the scroll stays within the same tile
 void adjustPlayField() {
-  byte *d1, *d2;
-  byte currentRow = (iScrollY >> 3) + (EDGES / 2);
-
-  int playFieldLength = PLAYFIELD_ROWS * PLAYFIELD_COLS;
-
-  int nextPlayfieldBit = (currentRow + VIEWPORT_HEIGHT) * PLAYFIELD_COLS,
-    cNextPlayfieldBit = nextPlayfieldBit % playFieldLength,
-    cNextRow = (currentRow + VIEWPORT_HEIGHT) % TILEMAP_HEIGHT;
-
-  int prevPlayfieldBit = currentRow * PLAYFIELD_COLS,
-    cPrevPlayfieldBit = prevPlayfieldBit % playFieldLength,
-    cPrevRow = currentRow % TILEMAP_HEIGHT;
-
-  d1 = &bPlayfield[cNextPlayfieldBit];
-  d2 = &bPlayfield[cPrevPlayfieldBit];
+  unsigned int row = ((unsigned int)iScrollY >> 3) + (EDGES / 2);
+  unsigned int col = ((unsigned int)iScrollX >> 3) + (EDGES / 2);
+  unsigned int first, last;
+  int iRows = row - uiRowTop, iCols = col - uiColLeft;
+
+  if (bPlayfieldValid && !iRows && !iCols)
+    return;
+  if (!bPlayfieldValid || iRows >= HELD_ROWS || iRows <= -HELD_ROWS ||
+      iCols >= HELD_COLS || iCols <= -HELD_COLS) {
+    reloadPlayField(); // jumped: the whole viewport
+    return;
+  }
 
-  for (byte x1 = 0; x1 < PLAYFIELD_COLS; x1++) {
-    memcpy_P(d1 + x1, &tileMap[cNextRow][x1], 1);
-    memcpy_P(d2 + x1, &tileMap[cPrevRow][x1], 1);
+  uiRowTop = row;
+  uiColLeft = col;
+  // new columns on the left or right, for the new rows
+  if (iCols > 0) {
+    first = col + HELD_COLS - iCols;
+    last = col + HELD_COLS - 1;
+  } else {
+    first = col;
+    last = col - iCols - 1;
+  }
+  for (; iCols && first <= last; first++) {
+    streamCol(first);
   }
-}
\ No newline at end of file
+  // new rows at the top or bottom, all held columns
+  if (iRows > 0) {
+    first = row + HELD_ROWS - iRows;
+    last = row + HELD_ROWS - 1;
+  } else {
+    first = row;
+    last = row - iRows - 1;
+  }
+  for (; iRows && first <= last; first++) {
+    streamRow(first);
+  }
+}
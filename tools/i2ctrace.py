@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Decode the SSD1306 I2C traffic from an SCL/SDA edge trace.
+
+Reads either the trace written by the native build (native/host.cpp -i: one
+"<scl> <sda>" line per change of the bus levels, "# frame N" before every
+frame) or a VCD file, e.g. from simavr, and prints per frame:
+
+  frame,transactions,cmd_bytes,data_bytes,scl_clocks
+
+-v lists every transaction as well: its SCL clocks and the bytes after the
+address, commands and data split by their control bytes. That shows what
+each oledSetPosition() or page write costs on the bus.
+
+A VCD has no frame markers: name its signals with -scl/-sda (a 1 bit wire,
+or bit n of a vector as name:n) and give -f to start a new frame at every
+transaction whose first command is that byte (e.g. -f 0xb0), the traffic
+before the first one is reported as "setup". Without -f the whole trace
+counts as one frame, "all".
+
+usage: tools/i2ctrace.py [-v] [-scl name[:bit] -sda name[:bit]] [-f cmd] trace
+"""
+
+import sys
+
+SSD1306_ADDR = 0x78  # 0x3c, write
+
+
+class Transaction:
+    def __init__(self, addr=None, continued=False):
+        self.clocks = 0
+        self.addr = addr
+        self.continued = continued  # the rest of one begun in an earlier frame
+        self.parts = []  # ("cmd" | "data", [bytes]) in bus order
+
+    def add(self, kind, b):
+        if not self.parts or self.parts[-1][0] != kind:
+            self.parts.append((kind, []))
+        self.parts[-1][1].append(b)
+
+    def count(self, kind):
+        return sum(len(p[1]) for p in self.parts if p[0] == kind)
+
+    def first_cmd(self):
+        for kind, data in self.parts:
+            if kind == "cmd":
+                return data[0]
+        return None
+
+    def __str__(self):
+        s = "  %3d clocks addr %s" % (self.clocks, "--" if self.addr is None
+                                      else "%02x" % self.addr)
+        if self.continued:
+            s += " (continued)"
+        for kind, data in self.parts:
+            if kind == "cmd" or len(data) <= 8:
+                s += " %s %s" % (kind, " ".join("%02x" % b for b in data))
+            else:
+                s += " data x%d" % len(data)
+        return s
+
+
+class Decoder:
+    """The same bus and control byte decoding as native/ssd1306.cpp"""
+
+    def __init__(self):
+        self.scl = self.sda = 1
+        self.tx = None
+        self.done = []
+
+    def levels(self, scl, sda):
+        if scl and self.scl and sda != self.sda:
+            if not sda:  # START (or repeated START)
+                self.end()
+                self.tx = Transaction()
+                self.bits = self.shift = 0
+                self.control = None
+            else:  # STOP
+                self.end()
+        elif scl and not self.scl and self.tx:
+            self.tx.clocks += 1
+            if self.bits < 8:
+                self.shift = ((self.shift << 1) | sda) & 0xff
+            self.bits += 1
+            if self.bits == 9:  # the 9th clock is the ACK
+                self.bits = 0
+                self.byte(self.shift)
+        self.scl, self.sda = scl, sda
+
+    def byte(self, b):
+        tx = self.tx
+        if tx.addr is None:
+            tx.addr = b
+        elif tx.addr != SSD1306_ADDR:
+            return
+        elif self.control is None:
+            self.control = b
+        else:
+            tx.add("data" if self.control & 0x40 else "cmd", b)
+            if self.control & 0x80:  # Co set: a single byte, then another control byte
+                self.control = None
+
+    def end(self):
+        if self.tx:
+            self.done.append(self.tx)
+            self.tx = None
+
+    def split(self):
+        """Book what the open transaction sent so far, it goes on decoding"""
+        if self.tx:
+            self.done.append(self.tx)
+            self.tx = Transaction(self.tx.addr, True)
+
+    def take(self):
+        done, self.done = self.done, []
+        return done
+
+
+def native_events(f):
+    for line in f:
+        line = line.strip()
+        if line.startswith("#"):
+            yield ("mark", line[1:].strip())
+        elif line:
+            scl, sda = line.split()
+            yield ("bus", int(scl), int(sda))
+
+
+def signal_spec(spec):
+    name, _, bit = spec.partition(":")
+    return name, int(bit) if bit else None
+
+
+def vcd_events(f, scl_spec, sda_spec):
+    if not scl_spec or not sda_spec:
+        sys.exit("a VCD needs -scl and -sda")
+    specs = [signal_spec(scl_spec), signal_spec(sda_spec)]
+    ids, names = {}, []
+    tokens = (t for line in f for t in line.split())
+    for t in tokens:  # header: $var <type> <width> <id> <name> ... $end
+        if t == "$var":
+            _, _, ident, name = next(tokens), next(tokens), next(tokens), next(tokens)
+            names.append(name)
+            for i, (want, bit) in enumerate(specs):
+                if name == want:
+                    ids.setdefault(ident, []).append((i, bit))
+        elif t == "$enddefinitions":
+            break
+    for i, (want, _) in enumerate(specs):
+        if not any(i == j for v in ids.values() for j, _ in v):
+            sys.exit("no signal %s in the VCD, it has: %s" % (want, " ".join(names)))
+
+    level = [1, 1]
+    for t in tokens:
+        if t[0] in "bB":
+            value, ident = t[1:], next(tokens)
+        elif t[0] in "01xXzZ":
+            value, ident = t[0], t[1:]
+        else:
+            continue  # timestamps, $dumpvars and the like
+        if ident not in ids:
+            continue
+        bits = value.lower().replace("x", "1").replace("z", "1")  # released lines float high
+        for i, bit in ids[ident]:
+            bit = bit or 0
+            level[i] = int(bits[-1 - bit]) if bit < len(bits) else 0  # vectors are zero extended
+        yield ("bus", level[0], level[1])
+
+
+def main():
+    args = sys.argv[1:]
+    verbose, scl, sda, frame_cmd, path = False, None, None, None, None
+    while args:
+        a = args.pop(0)
+        if a == "-v":
+            verbose = True
+        elif a in ("-scl", "-sda", "-f") and args:
+            v = args.pop(0)
+            if a == "-scl":
+                scl = v
+            elif a == "-sda":
+                sda = v
+            else:
+                frame_cmd = int(v, 0)
+        elif not a.startswith("-") and not path:
+            path = a
+        else:
+            path = None
+            break
+    if not path:
+        sys.exit(__doc__.strip())
+
+    f = open(path)
+    first = f.readline()
+    f.seek(0)
+    events = vcd_events(f, scl, sda) if first.lstrip().startswith("$") else native_events(f)
+
+    print("frame,transactions,cmd_bytes,data_bytes,scl_clocks")
+    bus = Decoder()
+    frame = ["all" if frame_cmd is None else "setup"]
+    txs = []
+
+    def report():
+        if frame[0] is None or (not txs and isinstance(frame[0], str)):
+            return
+        print("%s,%d,%d,%d,%d" % (frame[0], sum(not t.continued for t in txs),
+                                  sum(t.count("cmd") for t in txs),
+                                  sum(t.count("data") for t in txs),
+                                  sum(t.clocks for t in txs)))
+        if verbose:
+            for t in txs:
+                print(t)
+        del txs[:]
+
+    def collect():
+        for t in bus.take():
+            if frame_cmd is not None and not t.continued and t.first_cmd() == frame_cmd:
+                report()
+                frame[0] = frame[0] + 1 if isinstance(frame[0], int) else 0
+            txs.append(t)
+
+    for ev in events:
+        if ev[0] == "mark":
+            bus.split()  # a frame push stream stays open across frames
+            collect()
+            report()
+            words = ev[1].split()
+            frame[0] = int(words[1]) if words[:1] == ["frame"] else None  # None: setup, not reported
+            del txs[:]
+        else:
+            bus.levels(ev[1], ev[2])
+            collect()
+    bus.end()
+    collect()
+    report()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Compress a tile map into the per-row RLE format read by MAP_RLE.
+
+Reads the C initializer of a 2D map array (tileMap by default) from a source
+file and prints a header with:
+
+  ucMapRLE      (run length, tile) byte pairs, each row adds up to its width
+  uiMapRLERows  offset of every row in ucMapRLE, so rows decode on their own
+
+usage: tools/maprle.py src/main.cpp [array name] > include/tilemap_rle.h
+"""
+
+import re
+import sys
+
+MAX_RUN = 255
+
+
+def read_map(path, name):
+    text = open(path).read()
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//[^\n]*", "", text)
+    m = re.search(r"\b%s\s*\[[^]]*\]\s*\[[^]]*\][^=]*=\s*\{(.*?)\}\s*;" % re.escape(name),
+                  text, re.S)
+    if not m:
+        sys.exit("%s: no 2D array named %s" % (path, name))
+    rows = []
+    for body in re.findall(r"\{([^{}]*)\}", m.group(1)):
+        rows.append([int(v, 0) for v in body.replace(",", " ").split()])
+    if not rows or any(len(r) != len(rows[0]) for r in rows):
+        sys.exit("%s: rows of %s differ in length" % (path, name))
+    return rows
+
+
+def encode_row(row):
+    out = []
+    i = 0
+    while i < len(row):
+        run = 1
+        while i + run < len(row) and row[i + run] == row[i] and run < MAX_RUN:
+            run += 1
+        out += [run, row[i]]
+        i += run
+    return out
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__.strip())
+    path = sys.argv[1]
+    name = sys.argv[2] if len(sys.argv) > 2 else "tileMap"
+    rows = read_map(path, name)
+    data, offsets = [], []
+    for row in rows:
+        offsets.append(len(data))
+        data += encode_row(row)
+    raw = len(rows) * len(rows[0])
+
+    print("// Generated by tools/maprle.py from %s in %s, do not edit" % (name, path))
+    print("// %d rows x %d columns: %d bytes raw, %d bytes RLE + %d bytes row index"
+          % (len(rows), len(rows[0]), raw, len(data), 2 * len(rows)))
+    print("#define MAP_RLE_HEIGHT %d" % len(rows))
+    print("#define MAP_RLE_WIDTH %d" % len(rows[0]))
+    print()
+    print("const byte ucMapRLE[] PROGMEM = {")
+    for r, off in enumerate(offsets):
+        end = offsets[r + 1] if r + 1 < len(offsets) else len(data)
+        print("  /* %02d */ %s," % (r, ", ".join("%d" % b for b in data[off:end])))
+    print("};")
+    print()
+    print("const unsigned int uiMapRLERows[MAP_RLE_HEIGHT] PROGMEM = {")
+    for i in range(0, len(offsets), 8):
+        print("  %s," % ", ".join("%d" % o for o in offsets[i:i + 8]))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+"""Express a tile map in 2x2 metatiles for MAP_METATILES.
+
+Reads the C initializer of a 2D map array (tileMap by default) from a source
+file and prints a header with:
+
+  ucMetatiles  the distinct 2x2 blocks of the map: top left, top right,
+               bottom left, bottom right tile index
+  ucMetaMap    the map in metatiles, half the width and height (rounded up,
+               an odd last row or column repeats its neighbour)
+
+usage: tools/metatiles.py src/main.cpp [array name] > include/tilemap_meta.h
+"""
+
+import sys
+
+from maprle import read_map
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__.strip())
+    path = sys.argv[1]
+    name = sys.argv[2] if len(sys.argv) > 2 else "tileMap"
+    rows = read_map(path, name)
+    height, width = len(rows), len(rows[0])
+
+    def tile(y, x):
+        return rows[min(y, height - 1)][min(x, width - 1)]
+
+    metatiles, index, meta_map = [], {}, []
+    for y in range(0, height, 2):
+        meta_row = []
+        for x in range(0, width, 2):
+            block = (tile(y, x), tile(y, x + 1), tile(y + 1, x), tile(y + 1, x + 1))
+            if block not in index:
+                index[block] = len(metatiles)
+                metatiles.append(block)
+            meta_row.append(index[block])
+        meta_map.append(meta_row)
+    if len(metatiles) > 256:
+        sys.exit("%s: %d metatiles, at most 256 fit in a byte" % (name, len(metatiles)))
+
+    print("// Generated by tools/metatiles.py from %s in %s, do not edit" % (name, path))
+    print("// %d rows x %d columns: %d bytes raw, %d bytes of metatile map + %d metatiles"
+          " (%d bytes)" % (height, width, height * width, len(meta_map) * len(meta_map[0]),
+                            len(metatiles), 4 * len(metatiles)))
+    print("#define MAP_META_HEIGHT %d" % height)
+    print("#define MAP_META_WIDTH %d" % width)
+    print()
+    print("// 2x2 tiles: top left, top right, bottom left, bottom right")
+    print("const byte ucMetatiles[][4] PROGMEM = {")
+    for i, block in enumerate(metatiles):
+        print("  {%s}, // %d" % (", ".join("%d" % t for t in block), i))
+    print("};")
+    print()
+    print("const byte ucMetaMap[%d][%d] PROGMEM = {" % (len(meta_map), len(meta_map[0])))
+    for y, meta_row in enumerate(meta_map):
+        print("  /* %02d */ {%s}," % (2 * y, ", ".join("%2d" % m for m in meta_row)))
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""Convert PNG sheets into the PROGMEM tables of src/main.cpp.
+
+Lit pixels are the light ones (-invert: the dark ones), pixels with alpha
+below 128 (or the tRNS color) are transparent. Any PNG that isn't
+interlaced will do: gray, RGB or palette, with or without alpha.
+
+tiles: cuts each sheet into 8x8 cells, left to right and top to bottom, and
+prints ucTiles. Identical cells share one tile, the header lists which
+cell became which tile. Cells that are a flip of an earlier tile are only
+reported, the playfield has no flipped tiles.
+
+sprites: cuts each sheet into frames of the size given before it (height
+rounded up to whole pages, the padding is transparent) and prints
+spriteTable and ucSprites: mask 1 where the background shows, pattern 1
+where a lit pixel covers it. Frames that are identical to an earlier one or
+a flip of it (SPRITE_FLIP_H, SPRITE_FLIP_V or both) share its entry, so
+every frame gets SPRITE_<SHEET>_<n> (just SPRITE_<SHEET> for a single
+frame) and SPRITE_<SHEET>_<n>_FLAGS for GFX_OBJECT.bFlags. Fully
+transparent frames are skipped.
+
+The flash taken by every sheet goes into the header and to stderr.
+
+usage: tools/png2progmem.py [-invert] tiles sheet.png... > include/tiles.h
+       tools/png2progmem.py [-invert] sprites WxH sheet.png [WxH sheet.png]...
+           > include/sprites.h
+"""
+
+import os
+import re
+import struct
+import sys
+import zlib
+
+MODULE = 8
+SPRITE_DESC_SIZE = 6  # bWidth, bPages, uiMask, uiPattern
+MIRRORED = {"SPRITE_FLIP_H": "mirrored left to right",
+            "SPRITE_FLIP_V": "mirrored top to bottom",
+            "SPRITE_FLIP_H | SPRITE_FLIP_V": "turned 180 degrees"}
+
+
+# PNG *****************************************************************
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def unfilter(raw, width, height, bpp, stride):
+    rows, prev, i = [], bytearray(stride), 0
+    for _ in range(height):
+        ftype, line = raw[i], bytearray(raw[i + 1:i + 1 + stride])
+        i += 1 + stride
+        for x in range(stride):
+            a = line[x - bpp] if x >= bpp else 0
+            if ftype == 1:
+                line[x] = (line[x] + a) & 0xff
+            elif ftype == 2:
+                line[x] = (line[x] + prev[x]) & 0xff
+            elif ftype == 3:
+                line[x] = (line[x] + ((a + prev[x]) >> 1)) & 0xff
+            elif ftype == 4:
+                c = prev[x - bpp] if x >= bpp else 0
+                line[x] = (line[x] + paeth(a, prev[x], c)) & 0xff
+        rows.append(line)
+        prev = line
+    return rows
+
+
+def samples(line, width, channels, depth):
+    if depth == 8:
+        return list(line[:width * channels])
+    if depth == 16:
+        return [line[i] for i in range(0, width * channels * 2, 2)]  # high bytes
+    per = 8 // depth
+    mask = (1 << depth) - 1
+    return [(line[i // per] >> (8 - depth * (i % per + 1))) & mask
+            for i in range(width * channels)]
+
+
+def read_png(path, invert):
+    """Rows of pixels, each None (transparent) or 1/0 (lit or not)"""
+    data = open(path, "rb").read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        sys.exit("%s: not a PNG" % path)
+    pos, idat, palette, trns = 8, b"", None, None
+    while pos < len(data):
+        length, ctype = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if ctype == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif ctype == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif ctype == b"tRNS":
+            trns = body
+        elif ctype == b"IDAT":
+            idat += body
+        elif ctype == b"IEND":
+            break
+    if interlace:
+        sys.exit("%s: interlaced PNGs aren't supported" % path)
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(color)
+    if not channels:
+        sys.exit("%s: unknown color type %d" % (path, color))
+    stride = (width * channels * depth + 7) // 8
+    rows = unfilter(zlib.decompress(idat), width, height, max(1, channels * depth // 8), stride)
+
+    scale = 255 // ((1 << depth) - 1) if depth < 8 and color != 3 else 1
+    key = None
+    if trns and color == 0:
+        key = (struct.unpack(">H", trns[:2])[0],)
+    elif trns and color == 2:
+        key = struct.unpack(">HHH", trns[:6])
+    pixels = []
+    for line in rows:
+        s = samples(line, width, channels, depth)
+        out = []
+        for x in range(width):
+            p = s[x * channels:(x + 1) * channels]
+            alpha = 255
+            if color == 3:
+                alpha = trns[p[0]] if trns and p[0] < len(trns) else 255
+                r, g, b = palette[p[0]]
+            elif color in (0, 4):
+                r = g = b = p[0] * scale
+                alpha = p[1] if color == 4 else 255
+            else:
+                r, g, b = p[:3]
+                alpha = p[3] if color == 6 else 255
+            if key is not None and depth == 16:
+                raw = struct.unpack(">%dH" % channels, line[x * channels * 2:(x + 1) * channels * 2])
+                alpha = 0 if raw == key else alpha
+            elif key is not None and tuple(v // scale for v in (r, g, b)[:len(key)]) == key:
+                alpha = 0
+            if alpha < 128:
+                out.append(None)
+            else:
+                lit = (299 * r + 587 * g + 114 * b) // 1000 >= 128
+                out.append(int(lit != invert))
+        pixels.append(out)
+    return pixels
+
+
+# Conversion **********************************************************
+def cut(pixels, x0, y0, w, h):
+    """A w x h frame, outside the sheet is transparent"""
+    return tuple(tuple(pixels[y][x] if y < len(pixels) and x < len(pixels[y]) else None
+                       for x in range(x0, x0 + w)) for y in range(y0, y0 + h))
+
+
+def flips(frame):
+    """(flags, flipped frame) for every way the engine can mirror it"""
+    h = tuple(tuple(reversed(r)) for r in frame)
+    return [("SPRITE_FLIP_H", h), ("SPRITE_FLIP_V", tuple(reversed(frame))),
+            ("SPRITE_FLIP_H | SPRITE_FLIP_V", tuple(reversed(h)))]
+
+
+def pages(frame, bit):
+    """Column bytes page by page, bit 0 on top, for pixels where bit() holds"""
+    out = []
+    for p in range(len(frame) // MODULE):
+        for x in range(len(frame[0])):
+            out.append(sum(1 << y for y in range(MODULE) if bit(frame[p * MODULE + y][x])))
+    return out
+
+
+def hex_rows(data, width):
+    for i in range(0, len(data), width):
+        yield "  " + " ".join("0x%02x," % b for b in data[i:i + width])
+
+
+def sheet_name(path):
+    return re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0]).upper()
+
+
+def report(lines, text):
+    lines.append("// " + text)
+    sys.stderr.write(text + "\n")
+
+
+def tiles(paths, invert):
+    unique, seen, lines, body = [], {}, [], []
+    for path in paths:
+        pixels = read_png(path, invert)
+        if len(pixels) % MODULE or len(pixels[0]) % MODULE:
+            sys.exit("%s: %dx%d isn't a whole number of 8x8 cells"
+                     % (path, len(pixels[0]), len(pixels)))
+        cells, new, where = 0, 0, []
+        for y in range(0, len(pixels), MODULE):
+            for x in range(0, len(pixels[0]), MODULE):
+                tile = tuple(pages(cut(pixels, x, y, MODULE, MODULE), lambda p: p))
+                if tile not in seen:
+                    seen[tile] = len(unique)
+                    unique.append((tile, "%s cell %d" % (os.path.basename(path), cells)))
+                    new += 1
+                    frame = cut(pixels, x, y, MODULE, MODULE)
+                    for flags, f in flips(frame):
+                        t = tuple(pages(f, lambda p: p))
+                        if t in seen and seen[t] != len(unique) - 1:
+                            sys.stderr.write("%s: cell %d is tile %d %s, kept as tile %d\n"
+                                             % (path, cells, seen[t], MIRRORED[flags],
+                                                len(unique) - 1))
+                            break
+                where.append(seen[tile])
+                cells += 1
+        report(lines, "%s: %d cells, %d new tiles, %d bytes"
+               % (os.path.basename(path), cells, new, new * MODULE))
+        body.append("// %s cells -> tiles: %s" % (os.path.basename(path),
+                                                   " ".join("%d" % t for t in where)))
+    report(lines, "ucTiles: %d tiles, %d bytes" % (len(unique), len(unique) * MODULE))
+
+    print("// Generated by tools/png2progmem.py from %s, do not edit"
+          % ", ".join(os.path.basename(p) for p in paths))
+    print("\n".join(lines + body))
+    print("#define TILE_COUNT %d" % len(unique))
+    print()
+    print("const byte ucTiles[] PROGMEM = {")
+    for i, (tile, where) in enumerate(unique):
+        print("  %s // %s (%d)" % (", ".join("0x%02x" % b for b in tile) + ",", where, i))
+    print("};")
+
+
+def sprites(args, invert):
+    shapes, seen, blobs, data, lines, names = [], {}, {}, [], [], []
+    size, paths, pages_max = None, [], 0
+    for arg in args:
+        m = re.match(r"^(\d+)x(\d+)$", arg)
+        if m:
+            size = (int(m.group(1)), int(m.group(2)))
+            continue
+        if not size:
+            sys.exit("sprites: give the frame size (WxH) before %s" % arg)
+        w, h = size
+        if not 0 < w <= 128 or not 0 < h <= 64:
+            sys.exit("%s: frames of %dx%d, at most 128x64" % (arg, w, h))
+        h = (h + MODULE - 1) // MODULE * MODULE
+        pixels = read_png(arg, invert)
+        pad = ((None,) * w,) * (h - size[1])
+        frames = [cut(pixels, x, y, w, size[1]) + pad for y in range(0, len(pixels), size[1])
+                  for x in range(0, len(pixels[0]), w)]
+        frames = [f for f in frames if any(p is not None for r in f for p in r)]
+        base = "SPRITE_" + sheet_name(arg)
+        before, new = len(data), 0
+        for n, frame in enumerate(frames):
+            name = base if len(frames) == 1 else "%s_%d" % (base, n)
+            if frame in seen:
+                names.append((name, seen[frame][0], seen[frame][1]))
+                continue
+            flags = "0"
+            seen[frame] = (len(shapes), flags)
+            for f, flipped in flips(frame):
+                seen.setdefault(flipped, (len(shapes), f))
+            offsets = []
+            for bit in (lambda p: p is None, lambda p: p == 1):  # mask, pattern
+                blob = tuple(pages(frame, bit))
+                if blob not in blobs:  # a shape may share its mask or pattern
+                    blobs[blob] = len(data)
+                    data.extend(blob)
+                offsets.append(blobs[blob])
+            shapes.append((w, h // MODULE, offsets[0], offsets[1], name))
+            names.append((name, len(shapes) - 1, flags))
+            pages_max = max(pages_max, h // MODULE)
+            new += 1
+        paths.append(os.path.basename(arg))
+        report(lines, "%s: %d frames, %d new shapes, %d bytes + %d bytes of spriteTable"
+               % (paths[-1], len(frames), new, len(data) - before, new * SPRITE_DESC_SIZE))
+    if not shapes:
+        sys.exit(__doc__.strip())
+    if len(data) > 65535:
+        sys.exit("ucSprites: %d bytes, the offsets are 16 bit" % len(data))
+    report(lines, "ucSprites: %d shapes, %d bytes + %d bytes of spriteTable"
+           % (len(shapes), len(data), len(shapes) * SPRITE_DESC_SIZE))
+
+    print("// Generated by tools/png2progmem.py from %s, do not edit" % ", ".join(paths))
+    print("\n".join(lines))
+    print("#define SPRITE_SHEET_PAGES %d // tallest entry, for MAX_SPRITE_PAGES" % pages_max)
+    print()
+    for name, shape, flags in names:
+        print("#define %s %d" % (name, shape))
+        print("#define %s_FLAGS %s" % (name, "(%s)" % flags if "|" in flags else flags))
+    print()
+    print("const SPRITE_DESC spriteTable[] PROGMEM = {")
+    for w, p, mask, pattern, name in shapes:
+        print("  {%d, %d, %d, %d}, // %s" % (w, p, mask, pattern, name))
+    print("};")
+    print()
+    print("const byte ucSprites[] PROGMEM = {")
+    starts = {}
+    for w, p, mask, pattern, name in shapes:
+        starts.setdefault(mask, (name + " mask", w * p))
+        starts.setdefault(pattern, (name + " pattern", w * p))
+    for off in sorted(starts):
+        label, length = starts[off]
+        print("  // %s" % label)
+        print("\n".join(hex_rows(data[off:off + length], 8)))
+    print("};")
+
+
+def main():
+    args = sys.argv[1:]
+    invert = bool(args) and args[0] == "-invert"
+    if invert:
+        args.pop(0)
+    if len(args) < 2 or args[0] not in ("tiles", "sprites"):
+        sys.exit(__doc__.strip())
+    if args[0] == "tiles":
+        tiles(args[1:], invert)
+    else:
+        sprites(args[1:], invert)
+
+
+if __name__ == "__main__":
+    main()
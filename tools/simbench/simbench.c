@@ -0,0 +1,231 @@
+/*
+ * Cycle exact benchmarks: runs a firmware built with BENCHMARK and
+ * BENCHMARK_SIMAVR (pio run -e simbench) under simavr, no hardware needed.
+ *
+ * The firmware reads its cycle counter from GPIOR0 (see benchClock() in
+ * src/main.cpp) and prints "name,value" lines on the serial TX pin, which
+ * are decoded here and passed to stdout, followed by "sim_cycles,<total>".
+ *
+ * usage: simbench [-t pin] [-b baseline.csv [-p percent]] firmware.elf
+ *   -t  PORTB bit of the serial TX pin (default 0, 4 for I2C_USI builds)
+ *   -b  compare with an earlier run: every numeric result more than
+ *       -p percent (default 2) worse than its baseline is reported on stderr
+ *       and the exit status is 1. Worse is higher, except for the results
+ *       in szHigherIsBetter[].
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_ioport.h>
+
+#define GPIOR0_ADDR 0x31 // I/O 0x11 on the ATtiny85, in data space
+#define BAUD 115200
+#define MAX_RESULTS 256
+#define CYCLE_LIMIT 4000000000ULL // a firmware that never stops
+
+// Cycle counter latch *************************************************
+static uint32_t ulLatch;
+static int iLatchByte;
+
+static void LatchWrite(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param) {
+  ulLatch = (uint32_t)avr->cycle;
+  iLatchByte = 0;
+}
+
+static uint8_t LatchRead(avr_t *avr, avr_io_addr_t addr, void *param) {
+  return (uint8_t)(ulLatch >> (8 * (iLatchByte++ & 3)));
+}
+
+// Baseline ************************************************************
+typedef struct tag_result {
+  char szName[64];
+  double dValue;
+} RESULT;
+
+static RESULT baseline[MAX_RESULTS];
+static int iBaseline, iRegressions;
+static double dTolerance = 2.0;
+
+// Results where a drop is the regression, the rest are cycles or costs
+static const char *szHigherIsBetter[] = {"pages_skipped", "rows_streamed_per_sec", NULL};
+
+static int HigherIsBetter(const char *szName) {
+  int i;
+
+  for (i = 0; szHigherIsBetter[i]; i++) {
+    if (!strcmp(szName, szHigherIsBetter[i]))
+      return 1;
+  }
+  return 0;
+}
+
+// "name,number" into *p, 0 for anything else
+static int ParseResult(const char *szLine, RESULT *p) {
+  const char *c = strchr(szLine, ',');
+  char *end;
+
+  if (!c || c - szLine >= (int)sizeof(p->szName))
+    return 0;
+  p->dValue = strtod(c + 1, &end);
+  if (end == c + 1 || *end)
+    return 0;
+  memcpy(p->szName, szLine, c - szLine);
+  p->szName[c - szLine] = 0;
+  return 1;
+}
+
+static int ReadBaseline(const char *szName) {
+  char szLine[128];
+  FILE *f = fopen(szName, "r");
+
+  if (!f)
+    return 0;
+  while (iBaseline < MAX_RESULTS && fgets(szLine, sizeof(szLine), f)) {
+    szLine[strcspn(szLine, "\r\n")] = 0;
+    if (ParseResult(szLine, &baseline[iBaseline]))
+      iBaseline++;
+  }
+  fclose(f);
+  return 1;
+}
+
+static void CheckResult(const char *szLine) {
+  RESULT r;
+  int i;
+
+  if (!ParseResult(szLine, &r))
+    return;
+  for (i = 0; i < iBaseline; i++) {
+    if (strcmp(baseline[i].szName, r.szName))
+      continue;
+    if (HigherIsBetter(r.szName) ? r.dValue < baseline[i].dValue * (1 - dTolerance / 100)
+                                 : r.dValue > baseline[i].dValue * (1 + dTolerance / 100)) {
+      fprintf(stderr, "regression: %s %g -> %g\n", r.szName, baseline[i].dValue, r.dValue);
+      iRegressions++;
+    }
+    return;
+  }
+}
+
+// Serial receiver *****************************************************
+// ATtinySerialOut sends 8N1 with cycle counted delays: sample every bit in
+// its middle, the level between two edges is the one set by the first
+static double dBit;         // cycles per bit
+static int iLevel = 1;      // TX pin, idles high
+static int iBit = -1;       // bit being received, -1 while idle
+static double dSample;      // cycle of the next sample
+static uint8_t bRx;
+static char szLine[128];
+static int iLine;
+
+static void RxByte(uint8_t b) {
+  if (b == '\r')
+    return;
+  if (b != '\n') {
+    if (iLine < (int)sizeof(szLine) - 1)
+      szLine[iLine++] = b;
+    return;
+  }
+  szLine[iLine] = 0;
+  iLine = 0;
+  puts(szLine);
+  if (iBaseline)
+    CheckResult(szLine);
+}
+
+// Take the samples due before cycle, they all see the current level
+static void RxSamples(uint64_t cycle) {
+  while (iBit >= 0 && dSample < cycle) {
+    if (iBit < 8) {
+      bRx |= iLevel << iBit++;
+      dSample += dBit;
+    } else { // stop bit
+      RxByte(bRx);
+      iBit = -1;
+    }
+  }
+}
+
+static void TxPinChanged(struct avr_irq_t *irq, uint32_t value, void *param) {
+  avr_t *avr = (avr_t *)param;
+
+  RxSamples(avr->cycle);
+  if (iBit < 0 && iLevel && !value) { // start bit
+    iBit = 0;
+    bRx = 0;
+    dSample = avr->cycle + 1.5 * dBit;
+  }
+  iLevel = value != 0;
+}
+
+int main(int argc, char **argv) {
+  elf_firmware_t f;
+  avr_t *avr;
+  const char *szElf = NULL, *szBaseline = NULL;
+  int i, iTxPin = 0, state;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc)
+      iTxPin = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+      szBaseline = argv[++i];
+    else if (!strcmp(argv[i], "-p") && i + 1 < argc)
+      dTolerance = atof(argv[++i]);
+    else if (argv[i][0] != '-' && !szElf)
+      szElf = argv[i];
+    else {
+      szElf = NULL; // unknown option: usage
+      break;
+    }
+  }
+  if (!szElf) {
+    fprintf(stderr, "usage: %s [-t pin] [-b baseline.csv [-p percent]] firmware.elf\n", argv[0]);
+    return 2;
+  }
+  if (szBaseline && !ReadBaseline(szBaseline)) {
+    perror(szBaseline);
+    return 2;
+  }
+
+  memset(&f, 0, sizeof(f));
+  if (elf_read_firmware(szElf, &f)) {
+    fprintf(stderr, "%s: can't load\n", szElf);
+    return 2;
+  }
+  if (!f.mmcu[0])
+    strcpy(f.mmcu, "attiny85");
+  if (!f.frequency)
+    f.frequency = 8000000;
+  avr = avr_make_mcu_by_name(f.mmcu);
+  if (!avr) {
+    fprintf(stderr, "%s: unknown MCU %s\n", szElf, f.mmcu);
+    return 2;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &f);
+  dBit = (double)avr->frequency / BAUD;
+
+  avr_register_io_write(avr, GPIOR0_ADDR, LatchWrite, NULL);
+  avr_register_io_read(avr, GPIOR0_ADDR, LatchRead, NULL);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), iTxPin),
+                          TxPinChanged, avr);
+
+  do {
+    state = avr_run(avr);
+  } while (state != cpu_Done && state != cpu_Crashed && avr->cycle < CYCLE_LIMIT);
+  RxSamples(UINT64_MAX);
+  if (iLine)
+    RxByte('\n');
+  printf("sim_cycles,%llu\n", (unsigned long long)avr->cycle);
+
+  if (state != cpu_Done) {
+    fprintf(stderr, "%s: %s\n", szElf, state == cpu_Crashed ? "crashed" : "didn't stop");
+    return 1;
+  }
+  return iRegressions ? 1 : 0;
+}